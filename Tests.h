@@ -3,8 +3,12 @@
 #pragma once
 
 #include "cube.h"
+#include "persistenceData.h"
+#include "pointCloud.h"
+#include "simdDistance.h"
 #include "Core/ptr.h"
 
+#include <ostream>
 #include <string>
 
 class Domain;
@@ -67,11 +71,64 @@ public:
         return m_outputFilename;
     }
 
+    const std::string &GetTraceFilename() const
+    {
+        return m_traceFilename;
+    }
+
+    // Seconds between progress reports, 0 disables them.
+    constexpr double GetProgressInterval() const
+    {
+        return m_progressInterval;
+    }
+
+    // Empty when progress is reported to stderr.
+    const std::string &GetProgressFilename() const
+    {
+        return m_progressFilename;
+    }
+
     constexpr bool GetShowGraph() const
     {
         return m_showGraph;
     }
 
+    constexpr bool GetHardwareCounters() const
+    {
+        return m_hardwareCounters;
+    }
+
+    constexpr bool GetWriteCost() const
+    {
+        return m_writeCost;
+    }
+
+    // Storage of the point clouds the algorithms create, distances are still computed in double.
+    // The domain keeps its own double coordinates, e.g. the RandomCube randoms, whatever the precision.
+    constexpr PointCloud::Precision GetPrecision() const
+    {
+        return m_precision;
+    }
+
+    // Computes the persistence also in double precision, or in single precision if double was
+    // requested, and reports the differences.
+    constexpr bool GetComparePrecision() const
+    {
+        return m_comparePrecision;
+    }
+
+    // Instruction set of the batched distances, the best one supported by the CPU by default.
+    constexpr SimdDistance::InstructionSet GetInstructionSet() const
+    {
+        return m_instructionSet;
+    }
+
+    // Domain points are reordered along a space filling curve, results are reported in the generated order.
+    constexpr bool GetReorderDomain() const
+    {
+        return m_domainOrder != DomainOrder::Generated;
+    }
+
 private:
 
     enum class DomainType : uint
@@ -100,6 +157,13 @@ private:
         QuotientExitSet,
     };
 
+    enum class DomainOrder : uint
+    {
+        Generated,
+        Morton,
+    };
+
+    Domain *CreateGeneratedDomain() const;
     void CreateDomainCube( Cube &outCube ) const;
     bool ParseDouble( std::istream &stream, double &outValue ) const;
     bool ParseUint( std::istream &stream, uint &outValue ) const;
@@ -109,6 +173,8 @@ private:
     void ParseDomain( std::istream &stream );
     void ParseMap( std::istream &stream );
     void ParseMetrics( std::istream &stream );
+    void ParseDomainOrder( std::istream &stream );
+    void ParsePrecision( std::istream &stream );
     void ParseTest( std::istream &stream );
     void ParseEpsilons( std::istream &stream );
 
@@ -117,6 +183,7 @@ private:
     DomainType m_domainType;
     uint m_domainSize;
     Cube m_domainCube;
+    DomainOrder m_domainOrder;
 
     MapType m_mapType;
     o::DynArray<double> m_mapParams;
@@ -135,8 +202,16 @@ private:
     uint m_qualityFunctionNumber;
 
     std::string m_outputFilename;
+    std::string m_traceFilename;
+    double m_progressInterval;
+    std::string m_progressFilename;
 
     bool m_showGraph;
+    bool m_hardwareCounters;
+    bool m_writeCost;
+    PointCloud::Precision m_precision;
+    bool m_comparePrecision;
+    SimdDistance::InstructionSet m_instructionSet;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -150,6 +225,11 @@ public:
 private:
 
     static void RunSingle( const std::string &paramsString );
+    static void Compute( const TestParams &testParams );
+    static void ComputePersistence( const TestParams &testParams, const Domain &domain, const Map &map, const Domain &testDomain, const o::DynArray<double> &epsilons,
+                                    const Metrics &domainMetrics, const Metrics &graphMetrics, PersistenceData &outPersistenceData );
+    static void RestoreDomainOrder( const o::DynArray<uint> &permutation, PersistenceData &persistenceData );
+    static void ComparePersistence( const PersistenceData &reference, const PersistenceData &persistenceData, PointCloud::Precision precision, std::ostream &str );
     static void RunList( const std::string &filename );
     static bool ShowGraph( const std::string &filename );
 };
@@ -0,0 +1,124 @@
+// pbrendel (c) 2021
+
+#include "allocationTracker.h"
+
+#include <cstdlib>
+#include <new>
+
+
+AllocationTracker::Counters AllocationTracker::s_counters = { 0, 0 };
+size_t AllocationTracker::s_liveBytes = 0;
+size_t AllocationTracker::s_peakLiveBytes = 0;
+
+// Every block is preceded by its size, padded so the returned memory keeps the default alignment.
+constexpr size_t HEADER_SIZE = alignof( std::max_align_t );
+
+
+void *AllocationTracker::Allocate( size_t size )
+{
+    char *block = static_cast<char *>( malloc( size + HEADER_SIZE ) );
+    if ( block == nullptr )
+    {
+        throw std::bad_alloc();
+    }
+    *reinterpret_cast<size_t *>( block ) = size;
+    s_counters.m_allocations++;
+    s_counters.m_bytes += size;
+    s_liveBytes += size;
+    if ( s_liveBytes > s_peakLiveBytes )
+    {
+        s_peakLiveBytes = s_liveBytes;
+    }
+    return block + HEADER_SIZE;
+}
+
+
+void AllocationTracker::Free( void *ptr )
+{
+    if ( ptr == nullptr )
+    {
+        return;
+    }
+    char *block = static_cast<char *>( ptr ) - HEADER_SIZE;
+    s_liveBytes -= *reinterpret_cast<size_t *>( block );
+    free( block );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#if ALLOCATION_TRACKING
+
+void *operator new( size_t size )
+{
+    return AllocationTracker::Allocate( size );
+}
+
+
+void *operator new[]( size_t size )
+{
+    return AllocationTracker::Allocate( size );
+}
+
+
+void *operator new( size_t size, const std::nothrow_t & ) noexcept
+{
+    try
+    {
+        return AllocationTracker::Allocate( size );
+    }
+    catch ( const std::bad_alloc & )
+    {
+        return nullptr;
+    }
+}
+
+
+void *operator new[]( size_t size, const std::nothrow_t & ) noexcept
+{
+    try
+    {
+        return AllocationTracker::Allocate( size );
+    }
+    catch ( const std::bad_alloc & )
+    {
+        return nullptr;
+    }
+}
+
+
+void operator delete( void *ptr ) noexcept
+{
+    AllocationTracker::Free( ptr );
+}
+
+
+void operator delete[]( void *ptr ) noexcept
+{
+    AllocationTracker::Free( ptr );
+}
+
+
+void operator delete( void *ptr, size_t ) noexcept
+{
+    AllocationTracker::Free( ptr );
+}
+
+
+void operator delete[]( void *ptr, size_t ) noexcept
+{
+    AllocationTracker::Free( ptr );
+}
+
+
+void operator delete( void *ptr, const std::nothrow_t & ) noexcept
+{
+    AllocationTracker::Free( ptr );
+}
+
+
+void operator delete[]( void *ptr, const std::nothrow_t & ) noexcept
+{
+    AllocationTracker::Free( ptr );
+}
+
+#endif
@@ -0,0 +1,59 @@
+// pbrendel (c) 2021
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Set to 1 to replace the global operator new and delete with counting versions.
+// Only allocations going through operator new are seen by the tracker.
+#ifndef ALLOCATION_TRACKING
+#define ALLOCATION_TRACKING 0
+#endif
+
+
+class AllocationTracker
+{
+public:
+
+    struct Counters
+    {
+        uint64_t m_allocations;
+        uint64_t m_bytes;
+    };
+
+    static constexpr bool IsEnabled()
+    {
+        return ALLOCATION_TRACKING != 0;
+    }
+
+    // Totals since the start of the process.
+    static Counters GetCounters()
+    {
+        return s_counters;
+    }
+
+    static size_t GetLiveBytes()
+    {
+        return s_liveBytes;
+    }
+
+    static size_t GetPeakLiveBytes()
+    {
+        return s_peakLiveBytes;
+    }
+
+    static void ResetPeakLiveBytes()
+    {
+        s_peakLiveBytes = s_liveBytes;
+    }
+
+    static void *Allocate( size_t size );
+    static void Free( void *ptr );
+
+private:
+
+    static Counters s_counters;
+    static size_t s_liveBytes;
+    static size_t s_peakLiveBytes;
+};
@@ -0,0 +1,73 @@
+// pbrendel (c) 2021
+
+#include "arena.h"
+
+
+thread_local Arena *Arena::s_current = nullptr;
+
+
+Arena::Arena( size_t blockSize )
+    : m_block( 0 )
+    , m_offset( 0 )
+    , m_blockSize( blockSize )
+    , m_capacity( 0 )
+    , m_liveBuffers( 0 )
+    , m_footprint( MemoryFootprint::Category::Arena )
+{}
+
+
+Arena::~Arena()
+{
+    assert( m_liveBuffers == 0 && s_current != this );
+    for ( uint i = 0; i < m_blocks.GetSize(); ++i )
+    {
+        delete[] m_blocks[i].m_data;
+    }
+}
+
+
+void *Arena::Allocate( size_t size, size_t alignment )
+{
+    while ( m_block < m_blocks.GetSize() )
+    {
+        const Block &block = m_blocks[m_block];
+        const size_t offset = ( m_offset + alignment - 1 ) / alignment * alignment;
+        if ( offset + size <= block.m_size )
+        {
+            m_offset = offset + size;
+            return block.m_data + offset;
+        }
+        m_block++;
+        m_offset = 0;
+    }
+    // Blocks are allocated with new, so their alignment is enough for any type.
+    Block block;
+    block.m_size = std::max( m_blockSize, size );
+    block.m_data = new char[block.m_size];
+    m_blocks.PushBack( block );
+    m_capacity += block.m_size;
+    m_footprint.Update( m_capacity );
+    m_block = m_blocks.GetSize() - 1;
+    m_offset = size;
+    return block.m_data;
+}
+
+
+// Several blocks mean a center did not fit into one, they are merged so the next center fits.
+void Arena::Reset()
+{
+    assertex( m_liveBuffers == 0, "Arena reset while its buffers are in use" );
+    if ( m_blocks.GetSize() > 1 )
+    {
+        for ( uint i = 0; i < m_blocks.GetSize(); ++i )
+        {
+            delete[] m_blocks[i].m_data;
+        }
+        m_blocks.Clear();
+        m_blockSize = std::max( m_blockSize, m_capacity );
+        m_capacity = 0;
+        m_footprint.Update( 0 );
+    }
+    m_block = 0;
+    m_offset = 0;
+}
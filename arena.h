@@ -0,0 +1,221 @@
+// pbrendel (c) 2021
+
+#pragma once
+
+#include "memoryFootprint.h"
+#include "Core/assert.h"
+#include "Core/dynArray.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+
+// Monotonic allocator for the temporaries of a single center. Memory is taken from large blocks
+// and released all at once by Reset, the blocks are kept for the next center.
+class Arena
+{
+public:
+
+    explicit Arena( size_t blockSize = 1 << 20 );
+    ~Arena();
+
+    void *Allocate( size_t size, size_t alignment );
+
+    // All the buffers taken from the arena have to be released before.
+    void Reset();
+
+    // Arena of the calling thread, nullptr outside of ArenaScope.
+    static Arena *GetCurrent()
+    {
+        return s_current;
+    }
+
+    size_t GetCapacity() const
+    {
+        return m_capacity;
+    }
+
+private:
+
+    friend class ArenaScope;
+    template <class T>
+    friend class ArenaBuffer;
+
+    struct Block
+    {
+        char *m_data;
+        size_t m_size;
+    };
+
+    o::DynArray<Block> m_blocks;
+    uint m_block;
+    size_t m_offset;
+    size_t m_blockSize;
+    size_t m_capacity;
+    uint m_liveBuffers;
+    MemoryFootprintScope m_footprint;
+
+    static thread_local Arena *s_current;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Makes the arena current for the calling thread. The arena is reset when leaving the scope, so
+// the scope has to be declared before the objects drawing from the arena.
+class ArenaScope
+{
+public:
+
+    explicit ArenaScope( Arena &arena )
+        : m_arena( arena )
+        , m_previous( Arena::s_current )
+    {
+        Arena::s_current = &m_arena;
+    }
+
+    ~ArenaScope()
+    {
+        Arena::s_current = m_previous;
+        m_arena.Reset();
+    }
+
+private:
+
+    ArenaScope( const ArenaScope & ) = delete;
+    ArenaScope &operator=( const ArenaScope & ) = delete;
+
+    Arena &m_arena;
+    Arena *m_previous;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Buffer of trivially copyable elements with the interface of o::DynBuffer. Elements are taken
+// from the arena current at the time of the allocation, or from the heap if there is none.
+template <class T>
+class ArenaBuffer
+{
+    static_assert( std::is_trivially_copyable<T>::value, "ArenaBuffer elements are not destroyed" );
+
+public:
+
+    ArenaBuffer()
+        : m_data( nullptr )
+        , m_size( 0 )
+        , m_arena( nullptr )
+    {}
+
+    explicit ArenaBuffer( uint size )
+        : ArenaBuffer()
+    {
+        Reset( size );
+    }
+
+    ~ArenaBuffer()
+    {
+        Release();
+    }
+
+    // Contents are undefined.
+    void Reset( uint size )
+    {
+        Release();
+        Allocate( size );
+    }
+
+    // Keeps the contents of the first min( size, GetSize() ) elements.
+    void Resize( uint size )
+    {
+        T *data = m_data;
+        const uint count = std::min( size, m_size );
+        Arena *arena = m_arena;
+        Allocate( size );
+        if ( count > 0 )
+        {
+            memcpy( m_data, data, count * sizeof( T ) );
+        }
+        Free( data, arena );
+    }
+
+    T *Get() { return m_data; }
+    const T *Get() const { return m_data; }
+
+    uint GetSize() const
+    {
+        return m_size;
+    }
+
+    T &operator[]( uint index )
+    {
+        assert( index < m_size );
+        return m_data[index];
+    }
+
+    const T &operator[]( uint index ) const
+    {
+        assert( index < m_size );
+        return m_data[index];
+    }
+
+    void Clear()
+    {
+        memset( static_cast<void *>( m_data ), 0, m_size * sizeof( T ) );
+    }
+
+    void Clear( const T &value )
+    {
+        std::fill_n( m_data, m_size, value );
+    }
+
+private:
+
+    ArenaBuffer( const ArenaBuffer & ) = delete;
+    ArenaBuffer &operator=( const ArenaBuffer & ) = delete;
+
+    void Allocate( uint size )
+    {
+        m_size = size;
+        m_arena = Arena::GetCurrent();
+        if ( size == 0 )
+        {
+            m_data = nullptr;
+            m_arena = nullptr;
+        }
+        else if ( m_arena != nullptr )
+        {
+            m_data = static_cast<T *>( m_arena->Allocate( size * sizeof( T ), alignof( T ) ) );
+            m_arena->m_liveBuffers++;
+        }
+        else
+        {
+            m_data = new T[size];
+        }
+    }
+
+    static void Free( T *data, Arena *arena )
+    {
+        if ( arena != nullptr )
+        {
+            assert( arena->m_liveBuffers > 0 );
+            arena->m_liveBuffers--;
+        }
+        else
+        {
+            delete[] data;
+        }
+    }
+
+    void Release()
+    {
+        Free( m_data, m_arena );
+        m_data = nullptr;
+        m_size = 0;
+        m_arena = nullptr;
+    }
+
+    T *m_data;
+    uint m_size;
+    Arena *m_arena;
+};
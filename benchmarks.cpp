@@ -0,0 +1,953 @@
+// pbrendel (c) 2021
+
+#include "benchmarks.h"
+#include "Tests.h"
+#include "domain.h"
+#include "exitSetQuotientMetrics.h"
+#include "fixedDistance.h"
+#include "horseshoeMap.h"
+#include "localKernelsPersistence.h"
+#include "map.h"
+#include "memoryUsage.h"
+#include "metrics.h"
+#include "noise.h"
+#include "ripsComplex.h"
+#include "simdDistance.h"
+#include "Core/perfCounter.h"
+#include "Core/ptr.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using o::DynArray;
+using o::Ptr;
+
+
+BenchmarkParams::BenchmarkParams( int argc, char **argv )
+    : m_name( "metrics" )
+    , m_minTime( 0.2 )
+    , m_maxTime( 10.0 )
+    , m_repeatCount( 0 )
+    , m_threshold( 0.05 )
+{
+    int index = 2;
+    if ( index < argc && argv[index][0] != '-' )
+    {
+        m_name = argv[index++];
+    }
+    while ( index < argc )
+    {
+        const std::string str = argv[index++];
+        if ( str == "--dims" )
+        {
+            m_dimensions.Clear();
+            ParseUintList( argc, argv, index, m_dimensions );
+        }
+        else if ( str == "--points" )
+        {
+            m_sizes.Clear();
+            ParseUintList( argc, argv, index, m_sizes );
+        }
+        else if ( str == "--eps" )
+        {
+            m_epsilonFactors.Clear();
+            ParseDoubleList( argc, argv, index, m_epsilonFactors );
+        }
+        else if ( str == "--time" && index < argc )
+        {
+            m_minTime = atof( argv[index++] );
+        }
+        else if ( str == "--max-time" && index < argc )
+        {
+            m_maxTime = atof( argv[index++] );
+        }
+        else if ( str == "--csv" && index < argc )
+        {
+            m_outputFilename = argv[index++];
+        }
+        else if ( str == "--repeat" && index < argc )
+        {
+            m_repeatCount = std::max( 1, atoi( argv[index++] ) );
+        }
+        else if ( str == "--json" && index < argc )
+        {
+            m_jsonFilename = argv[index++];
+        }
+        else if ( str == "--baseline" && index < argc )
+        {
+            m_baselineFilename = argv[index++];
+        }
+        else if ( str == "--threshold" && index < argc )
+        {
+            m_threshold = atof( argv[index++] );
+        }
+        else
+        {
+            std::cout << "error parsing benchmark params: unknown option: " << str << std::endl;
+        }
+    }
+    // Median and MAD need a few samples to tell noise from a regression.
+    if ( m_repeatCount == 0 )
+    {
+        m_repeatCount = ( m_jsonFilename.empty() && m_baselineFilename.empty() ) ? 1 : 5;
+    }
+}
+
+
+void BenchmarkParams::SetDefaults( const DynArray<uint> &dimensions, const DynArray<uint> &sizes, const DynArray<double> &epsilonFactors )
+{
+    if ( m_dimensions.IsEmpty() )
+    {
+        m_dimensions = dimensions;
+    }
+    if ( m_sizes.IsEmpty() )
+    {
+        m_sizes = sizes;
+    }
+    if ( m_epsilonFactors.IsEmpty() )
+    {
+        m_epsilonFactors = epsilonFactors;
+    }
+}
+
+
+bool BenchmarkParams::ParseUintList( int argc, char **argv, int &index, DynArray<uint> &outValues ) const
+{
+    while ( index < argc && argv[index][0] != '-' )
+    {
+        outValues.PushBack( static_cast<uint>( atoi( argv[index++] ) ) );
+    }
+    return !outValues.IsEmpty();
+}
+
+
+bool BenchmarkParams::ParseDoubleList( int argc, char **argv, int &index, DynArray<double> &outValues ) const
+{
+    while ( index < argc && argv[index][0] != '-' )
+    {
+        outValues.PushBack( atof( argv[index++] ) );
+    }
+    return !outValues.IsEmpty();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void BenchmarkResults::Add( const std::string &name, const char *unit, double value )
+{
+    Entry *entry = Find( name );
+    if ( entry == nullptr )
+    {
+        m_entries.PushBack( Entry() );
+        entry = &m_entries.Back();
+        entry->m_name = name;
+        entry->m_unit = unit;
+        entry->m_median = 0.0;
+        entry->m_mad = 0.0;
+    }
+    entry->m_samples.PushBack( value );
+}
+
+
+void BenchmarkResults::UpdateStatistics()
+{
+    for ( DynArray<Entry>::Iterator it = m_entries.Begin(); it != m_entries.End(); ++it )
+    {
+        UpdateStatistics( *it );
+    }
+}
+
+
+bool BenchmarkResults::Write( const std::string &filename ) const
+{
+    std::ofstream output( filename.c_str() );
+    if ( !output.is_open() )
+    {
+        return false;
+    }
+    output << std::setprecision( 10 ) << "{\"benchmarks\":[" << std::endl;
+    const uint count = m_entries.GetSize();
+    for ( uint i = 0; i < count; ++i )
+    {
+        const Entry &entry = m_entries[i];
+        output << "{\"name\":\"" << entry.m_name << "\",\"unit\":\"" << entry.m_unit << "\",\"median\":" << entry.m_median
+               << ",\"mad\":" << entry.m_mad << ",\"samples\":[";
+        for ( uint j = 0; j < entry.m_samples.GetSize(); ++j )
+        {
+            output << ( j > 0 ? "," : "" ) << entry.m_samples[j];
+        }
+        output << "]}" << ( i + 1 < count ? "," : "" ) << std::endl;
+    }
+    output << "]}" << std::endl;
+    return true;
+}
+
+
+bool BenchmarkResults::Read( const std::string &filename )
+{
+    std::ifstream input( filename.c_str() );
+    if ( !input.is_open() )
+    {
+        return false;
+    }
+    m_entries.Clear();
+    std::string line;
+    while ( getline( input, line ) )
+    {
+        const size_t nameBegin = line.find( "{\"name\":\"" );
+        const size_t unitBegin = line.find( "\"unit\":\"" );
+        const size_t samplesBegin = line.find( "\"samples\":[" );
+        if ( nameBegin == std::string::npos || unitBegin == std::string::npos || samplesBegin == std::string::npos )
+        {
+            continue;
+        }
+        const size_t nameOffset = nameBegin + strlen( "{\"name\":\"" );
+        const size_t unitOffset = unitBegin + strlen( "\"unit\":\"" );
+        const std::string name = line.substr( nameOffset, line.find( '"', nameOffset ) - nameOffset );
+        const std::string unit = line.substr( unitOffset, line.find( '"', unitOffset ) - unitOffset );
+        std::istringstream samples( line.substr( samplesBegin + strlen( "\"samples\":[" ) ) );
+        double value;
+        char separator = ',';
+        while ( separator == ',' && samples >> value )
+        {
+            Add( name, unit.c_str(), value );
+            samples >> separator;
+        }
+    }
+    UpdateStatistics();
+    return !m_entries.IsEmpty();
+}
+
+
+uint BenchmarkResults::Compare( const BenchmarkResults &baseline, double threshold, std::ostream &str ) const
+{
+    // Scales the median absolute deviation to the standard deviation of a normal distribution.
+    const double madToSigma = 1.4826;
+    const double significance = 3.0;
+    str << std::left << std::setw( 72 ) << "benchmark" << std::right
+        << std::setw( 14 ) << "baseline"
+        << std::setw( 14 ) << "current"
+        << std::setw( 10 ) << "ratio"
+        << "  status" << std::endl;
+    uint regressions = 0;
+    for ( DynArray<Entry>::ConstIterator it = m_entries.Begin(); it != m_entries.End(); ++it )
+    {
+        const Entry *base = baseline.Find( it->m_name );
+        str << std::left << std::setw( 72 ) << it->m_name << std::right;
+        if ( base == nullptr )
+        {
+            str << std::setw( 14 ) << "-" << std::setw( 14 ) << it->m_median << std::setw( 10 ) << "-" << "  new" << std::endl;
+            continue;
+        }
+        const double ratio = base->m_median > 0.0 ? it->m_median / base->m_median : 1.0;
+        const double sigma = madToSigma * sqrt( base->m_mad * base->m_mad + it->m_mad * it->m_mad );
+        const double difference = it->m_median - base->m_median;
+        const bool significant = fabs( difference ) > significance * sigma && fabs( ratio - 1.0 ) > threshold;
+        const char *status = "ok";
+        if ( significant && difference > 0.0 )
+        {
+            status = "SLOWER";
+            regressions++;
+        }
+        else if ( significant )
+        {
+            status = "faster";
+        }
+        str << std::setw( 14 ) << base->m_median << std::setw( 14 ) << it->m_median
+            << std::setw( 10 ) << std::fixed << std::setprecision( 3 ) << ratio << "  " << status << std::endl;
+        str.unsetf( std::ios_base::floatfield );
+        str << std::setprecision( 6 );
+    }
+    // Benchmarks skipped once a run exceeds the time limit disappear from the results, a slowdown may be the cause.
+    uint missing = 0;
+    for ( DynArray<Entry>::ConstIterator it = baseline.m_entries.Begin(); it != baseline.m_entries.End(); ++it )
+    {
+        if ( Find( it->m_name ) == nullptr )
+        {
+            str << std::left << std::setw( 72 ) << it->m_name << std::right
+                << std::setw( 14 ) << it->m_median << std::setw( 14 ) << "-" << std::setw( 10 ) << "-" << "  MISSING" << std::endl;
+            missing++;
+        }
+    }
+    str << regressions << " significant slowdown(s), " << missing << " missing benchmark(s)" << std::endl;
+    return regressions + missing;
+}
+
+
+BenchmarkResults::Entry *BenchmarkResults::Find( const std::string &name )
+{
+    for ( DynArray<Entry>::Iterator it = m_entries.Begin(); it != m_entries.End(); ++it )
+    {
+        if ( it->m_name == name )
+        {
+            return &*it;
+        }
+    }
+    return nullptr;
+}
+
+
+const BenchmarkResults::Entry *BenchmarkResults::Find( const std::string &name ) const
+{
+    for ( DynArray<Entry>::ConstIterator it = m_entries.Begin(); it != m_entries.End(); ++it )
+    {
+        if ( it->m_name == name )
+        {
+            return &*it;
+        }
+    }
+    return nullptr;
+}
+
+
+void BenchmarkResults::UpdateStatistics( Entry &entry )
+{
+    std::vector<double> values( entry.m_samples.Begin(), entry.m_samples.End() );
+    const size_t middle = values.size() / 2;
+    std::sort( values.begin(), values.end() );
+    entry.m_median = values.size() % 2 == 1 ? values[middle] : ( values[middle - 1] + values[middle] ) * 0.5;
+    for ( double &value : values )
+    {
+        value = fabs( value - entry.m_median );
+    }
+    std::sort( values.begin(), values.end() );
+    entry.m_mad = values.size() % 2 == 1 ? values[middle] : ( values[middle - 1] + values[middle] ) * 0.5;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename T, uint N>
+DynArray<T> MakeList( const T ( &values )[N] )
+{
+    DynArray<T> list;
+    for ( uint i = 0; i < N; ++i )
+    {
+        list.PushBack( values[i] );
+    }
+    return list;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Evaluates distances between each point and its PAIRS_WINDOW successors, which mimics
+// the access pattern of RipsComplex::CreateEdges. The number of calls is doubled until
+// a single measurement takes at least the requested time.
+class MetricsBenchmark
+{
+public:
+
+    MetricsBenchmark( const PointCloud &points, double minTime, BenchmarkResults &results )
+        : m_points( points )
+        , m_minTime( minTime )
+        , m_results( results )
+    {}
+
+    static void PrintHeader()
+    {
+        std::cout << std::left << std::setw( 32 ) << "metrics" << std::right
+                  << std::setw( 6 ) << "dim"
+                  << std::setw( 10 ) << "points"
+                  << std::setw( 14 ) << "calls"
+                  << std::setw( 12 ) << "ns/call"
+                  << std::setw( 16 ) << "calls/sec" << std::endl;
+    }
+
+    void Measure( const char *name, const Metrics &metrics, uint dim, bool useIndices ) const
+    {
+        MeasureDistance( name, GenericDistance( m_points, metrics ), dim, useIndices );
+    }
+
+    // Measures the fixed dimension kernel of the metrics, if there is one for the dimension of the points.
+    void MeasureFixed( const char *name, const Metrics &metrics, uint dim ) const
+    {
+        FixedVisitor visitor = { *this, name, dim, false };
+        DispatchFixedDistance( m_points, metrics, visitor );
+    }
+
+    // Measures GetDistances of the fixed dimension kernel over windows of the candidates, time is given per distance.
+    void MeasureBatch( const char *name, const Metrics &metrics, uint dim ) const
+    {
+        FixedVisitor visitor = { *this, name, dim, true };
+        DispatchFixedDistance( m_points, metrics, visitor );
+    }
+
+    // Graph points of the same size as the benchmark points, read in place from the domain and range clouds.
+    void MeasureGraph( const char *name, const char *fixedName, const GraphPointCloud &graphPoints, const Metrics &metrics, uint dim ) const
+    {
+        assert( graphPoints.GetSize() == m_points.GetSize() );
+        MeasureDistance( name, GenericGraphDistance( graphPoints, metrics ), dim, false );
+        FixedVisitor visitor = { *this, fixedName, dim, false };
+        DispatchFixedDistance( graphPoints, metrics, visitor );
+    }
+
+private:
+
+    enum : uint
+    {
+        PAIRS_WINDOW = 32,
+    };
+
+    struct FixedVisitor
+    {
+        const MetricsBenchmark &m_benchmark;
+        const char *m_name;
+        uint m_dim;
+        bool m_batches;
+
+        template <class Distance>
+        void Visit( const Distance &distance )
+        {
+            m_benchmark.MeasureDistance( m_name, distance, m_dim, false, m_batches );
+        }
+    };
+
+    template <class Distance>
+    void MeasureDistance( const char *name, const Distance &distance, uint dim, bool useIndices, bool batches = false ) const
+    {
+        uint calls = 1024;
+        double time = 0.0;
+        double checksum = 0.0;
+        while ( true )
+        {
+            time = batches ? RunBatches( distance, calls, checksum ) : RunBatch( distance, calls, useIndices, checksum );
+            if ( time >= m_minTime || calls >= ( 1u << 30 ) )
+            {
+                break;
+            }
+            calls *= 2;
+        }
+        const double nsPerCall = time * 1e9 / calls;
+        std::cout << std::left << std::setw( 32 ) << name << std::right
+                  << std::setw( 6 ) << dim
+                  << std::setw( 10 ) << m_points.GetSize()
+                  << std::setw( 14 ) << calls
+                  << std::setw( 12 ) << std::fixed << std::setprecision( 2 ) << nsPerCall
+                  << std::setw( 16 ) << std::setprecision( 0 ) << calls / time << std::endl;
+        std::cout.unsetf( std::ios_base::floatfield );
+        // Keeps the compiler from dropping the evaluated distances.
+        if ( checksum < 0.0 )
+        {
+            std::cout << checksum << std::endl;
+        }
+        std::ostringstream key;
+        key << "metrics/" << name << "/dim" << dim << "/points" << m_points.GetSize();
+        m_results.Add( key.str(), "ns", nsPerCall );
+    }
+
+    template <class Distance>
+    double RunBatch( const Distance &distance, uint calls, bool useIndices, double &checksum ) const
+    {
+        const uint count = m_points.GetSize();
+        const uint window = std::min<uint>( PAIRS_WINDOW, count - 1 );
+        uint i = 0;
+        uint k = 1;
+        PerfCounter pc;
+        pc.Reset();
+        for ( uint c = 0; c < calls; ++c )
+        {
+            const uint j = ( i + k ) % count;
+            checksum += distance.GetDistance( distance.Load( i ), distance.Load( j ), useIndices ? i : Metrics::NO_INDEX, useIndices ? j : Metrics::NO_INDEX );
+            if ( ++k > window )
+            {
+                k = 1;
+                i = ( i + 1 ) % count;
+            }
+        }
+        return pc.Reset();
+    }
+
+    // The same pairs as RunBatch, a window of candidates per GetDistances call.
+    template <class Distance>
+    double RunBatches( const Distance &distance, uint calls, double &checksum ) const
+    {
+        const uint count = m_points.GetSize();
+        const uint window = std::min<uint>( PAIRS_WINDOW, count - 1 );
+        DynArray<uint> indices;
+        for ( uint k = 0; k < count + window; ++k )
+        {
+            indices.PushBack( k % count );
+        }
+        double distances[PAIRS_WINDOW];
+        uint i = 0;
+        PerfCounter pc;
+        pc.Reset();
+        for ( uint c = 0; c < calls; c += window )
+        {
+            distance.GetDistances( distance.Load( i ), Metrics::NO_INDEX, &indices[i + 1], window, distances );
+            for ( uint k = 0; k < window; ++k )
+            {
+                checksum += distances[k];
+            }
+            i = ( i + 1 ) % count;
+        }
+        return pc.Reset();
+    }
+
+    const PointCloud &m_points;
+    double m_minTime;
+    BenchmarkResults &m_results;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Point clouds filling the unit cube, used by the RipsComplex benchmark.
+class PointsGenerator
+{
+public:
+
+    enum class Distribution : uint
+    {
+        Uniform,
+        Random,
+        Clustered,
+        // All the points but the first lie on a sphere centered at the first one, so they
+        // have the same reference distance and RipsComplex::CreateEdges tests every pair.
+        Degenerate,
+        Count,
+    };
+
+    static const char *GetName( Distribution distribution )
+    {
+        switch ( distribution )
+        {
+        case Distribution::Uniform: return "uniform";
+        case Distribution::Random: return "random";
+        case Distribution::Clustered: return "clustered";
+        case Distribution::Degenerate: return "degenerate";
+        default: return "unknown";
+        }
+    }
+
+    static void Create( Distribution distribution, uint dim, uint count, PointCloud &outPoints )
+    {
+        outPoints.Clear();
+        Cube cube;
+        for ( uint d = 0; d < dim; ++d )
+        {
+            cube.AddDimension( Interval( 0, 1 ) );
+        }
+        if ( distribution == Distribution::Uniform )
+        {
+            const uint resolution = std::max( 2u, static_cast<uint>( pow( count, 1.0 / dim ) + 0.5 ) );
+            DynArray<uint> resolutions;
+            for ( uint d = 0; d < dim; ++d )
+            {
+                resolutions.PushBack( resolution );
+            }
+            CreateFromDomain( UniformCube( cube, resolutions, nullptr ), outPoints );
+        }
+        else if ( distribution == Distribution::Random )
+        {
+            CreateFromDomain( RandomCube( cube, count, nullptr ), outPoints );
+        }
+        else if ( distribution == Distribution::Clustered )
+        {
+            const uint clustersCount = 16;
+            const double clusterSize = 0.05;
+            RandomCube centers( cube, clustersCount, nullptr );
+            Point center( dim );
+            Point p( dim );
+            for ( uint i = 0; i < count; ++i )
+            {
+                centers.GetValue( i % clustersCount, center );
+                for ( uint d = 0; d < dim; ++d )
+                {
+                    p[d] = center[d] * ( 1.0 - clusterSize ) + GetRandom() * clusterSize;
+                }
+                outPoints.PushBack( p );
+            }
+        }
+        else
+        {
+            Point p( dim );
+            for ( uint d = 0; d < dim; ++d )
+            {
+                p[d] = 0.5;
+            }
+            outPoints.PushBack( p );
+            for ( uint i = 1; i < count; ++i )
+            {
+                double length = 0.0;
+                for ( uint d = 0; d < dim; ++d )
+                {
+                    p[d] = GetRandom() - 0.5;
+                    length += p[d] * p[d];
+                }
+                length = std::max( sqrt( length ), 1e-9 );
+                for ( uint d = 0; d < dim; ++d )
+                {
+                    p[d] = 0.5 + p[d] * 0.5 / length;
+                }
+                outPoints.PushBack( p );
+            }
+        }
+    }
+
+private:
+
+    static double GetRandom()
+    {
+        return static_cast<double>( rand() ) / RAND_MAX;
+    }
+
+    static void CreateFromDomain( const Domain &domain, PointCloud &outPoints )
+    {
+        domain.GetValues( outPoints );
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool Benchmarks::IsBenchmarkCommand( int argc, char **argv )
+{
+    return argc >= 2 && strcmp( argv[1], "--bench" ) == 0;
+}
+
+
+int Benchmarks::Run( int argc, char **argv )
+{
+    BenchmarkParams params( argc, argv );
+    BenchmarkResults results;
+    bool verified = true;
+    for ( uint i = 0; i < params.GetRepeatCount(); ++i )
+    {
+        // Every pass generates the same point clouds, so the spread of the samples is the timing noise only.
+        srand( RANDOM_SEED );
+        if ( params.GetName() == "metrics" )
+        {
+            RunMetrics( params, results );
+        }
+        else if ( params.GetName() == "rips" )
+        {
+            verified = RunRips( params, results ) && verified;
+        }
+        else if ( params.GetName() == "scaling" )
+        {
+            RunScaling( params, results );
+        }
+        else
+        {
+            std::cout << "unknown benchmark: " << params.GetName() << std::endl;
+            std::cout << "usage: program_name --bench metrics|rips|scaling [--dims d...] [--points n...] [--eps factor...] [--time seconds] [--max-time seconds] [--csv filename]"
+                      << " [--repeat count] [--json filename] [--baseline filename] [--threshold fraction]" << std::endl;
+            return 1;
+        }
+    }
+    results.UpdateStatistics();
+    if ( !verified )
+    {
+        std::cout << "rips edges differ from the brute force count" << std::endl;
+    }
+
+    if ( !params.GetJsonFilename().empty() && !results.Write( params.GetJsonFilename() ) )
+    {
+        std::cout << "cannot write benchmark results to " << params.GetJsonFilename() << std::endl;
+    }
+    if ( !params.GetBaselineFilename().empty() )
+    {
+        BenchmarkResults baseline;
+        if ( !baseline.Read( params.GetBaselineFilename() ) )
+        {
+            std::cout << "cannot read benchmark baseline " << params.GetBaselineFilename() << " or it has no entries" << std::endl;
+            return 1;
+        }
+        return results.Compare( baseline, params.GetThreshold(), std::cout ) > 0 || !verified ? 1 : 0;
+    }
+    return verified ? 0 : 1;
+}
+
+
+void Benchmarks::RunMetrics( BenchmarkParams &params, BenchmarkResults &results )
+{
+    const uint defaultDimensions[] = { 1, 2, 3, 4 };
+    const uint defaultSizes[] = { 1000, 10000 };
+    const double defaultEpsilonFactors[] = { 1.0 };
+    params.SetDefaults( MakeList( defaultDimensions ), MakeList( defaultSizes ), MakeList( defaultEpsilonFactors ) );
+    MetricsBenchmark::PrintHeader();
+    const DynArray<uint> &dimensions = params.GetDimensions();
+    const DynArray<uint> &sizes = params.GetSizes();
+    for ( DynArray<uint>::ConstIterator dim = dimensions.Begin(); dim != dimensions.End(); ++dim )
+    {
+        for ( DynArray<uint>::ConstIterator size = sizes.Begin(); size != sizes.End(); ++size )
+        {
+            if ( *size < 2 )
+            {
+                continue;
+            }
+            Cube cube;
+            for ( uint d = 0; d < *dim; ++d )
+            {
+                cube.AddDimension( Interval( 0, 1 ) );
+            }
+            RandomCube domain( cube, *size, nullptr );
+            PointCloud points;
+            domain.GetValues( points );
+            const MetricsBenchmark benchmark( points, params.GetMinTime(), results );
+            benchmark.Measure( "EuclideanMetrics", EuclideanMetrics::Get(), *dim, false );
+            benchmark.Measure( "MaxMetrics", MaxMetrics::Get(), *dim, false );
+            benchmark.Measure( "TaxiMetrics", TaxiMetrics::Get(), *dim, false );
+            benchmark.MeasureFixed( "FixedEuclideanMetrics", EuclideanMetrics::Get(), *dim );
+            benchmark.MeasureFixed( "FixedMaxMetrics", MaxMetrics::Get(), *dim );
+            benchmark.MeasureFixed( "FixedTaxiMetrics", TaxiMetrics::Get(), *dim );
+            // Batches with every instruction set the CPU supports, the scalar one included.
+            const SimdDistance::InstructionSet instructionSet = SimdDistance::Get();
+            for ( uint s = 0; s <= static_cast<uint>( SimdDistance::GetSupported() ); ++s )
+            {
+                SimdDistance::Set( static_cast<SimdDistance::InstructionSet>( s ) );
+                const std::string suffix = std::string( "Batch/" ) + SimdDistance::GetName( SimdDistance::Get() );
+                benchmark.MeasureBatch( ( "Euclidean" + suffix ).c_str(), EuclideanMetrics::Get(), *dim );
+                benchmark.MeasureBatch( ( "Max" + suffix ).c_str(), MaxMetrics::Get(), *dim );
+                benchmark.MeasureBatch( ( "Taxi" + suffix ).c_str(), TaxiMetrics::Get(), *dim );
+            }
+            SimdDistance::Set( instructionSet );
+
+            // Scaling the cube by 1.5 sends about a half of the points outside, so the exit set is not empty.
+            DynArray<double> factors;
+            for ( uint d = 0; d < *dim; ++d )
+            {
+                factors.PushBack( 1.5 );
+            }
+            LinearMap map( *dim, factors, nullptr );
+            ExitSetQuotientMetrics exitSetMetrics( domain, map, EuclideanMetrics::Get() );
+            benchmark.Measure( "ExitSetQuotientMetrics", exitSetMetrics, *dim, false );
+            Ptr<IndexMetrics> exitSetIndexMetrics = exitSetMetrics.CreateIndexMetrics( points );
+            benchmark.Measure( "ExitSetQuotientIndexMetrics", *exitSetIndexMetrics, *dim, true );
+
+            if ( *dim == 2 )
+            {
+                HorseshoeU horseshoe( 0.1, 0.1, domain, 0.0, nullptr );
+                benchmark.Measure( "HorseshoeExitSetQuotientMetrics", horseshoe.GetExitSetQuotientMetrics(), *dim, false );
+            }
+
+            // Graph points have both domain and range coordinates.
+            PointCloud rangePoints( *dim, *size );
+            Point d( *dim );
+            Point r( *dim );
+            for ( uint i = 0; i < *size; ++i )
+            {
+                points.GetValue( i, d );
+                map.GetValue( d, r );
+                rangePoints.Set( i, r );
+            }
+            const GraphPointCloud graphPoints( points, rangePoints );
+            MaxDomainRangeMetrics graphMetrics( EuclideanMetrics::Get(), EuclideanMetrics::Get(), *dim, *dim );
+            benchmark.MeasureGraph( "MaxDomainRangeMetrics", "FixedMaxDomainRangeMetrics", graphPoints, graphMetrics, *dim );
+        }
+    }
+}
+
+
+// Number of pairs of points within epsilon, each pair tested on its own.
+static uint64_t CountEdgesBruteForce( const PointCloud &points, const Metrics &metrics, double epsilon )
+{
+    const uint count = points.GetSize();
+    Point x( points.GetDimension() );
+    Point y( points.GetDimension() );
+    uint64_t edgesCount = 0;
+    for ( uint i = 0; i < count; ++i )
+    {
+        points.GetValue( i, x );
+        for ( uint j = i + 1; j < count; ++j )
+        {
+            points.GetValue( j, y );
+            if ( metrics.GetDistance( x, y, i, j ) <= epsilon )
+            {
+                edgesCount++;
+            }
+        }
+    }
+    return edgesCount;
+}
+
+
+bool Benchmarks::RunRips( BenchmarkParams &params, BenchmarkResults &results )
+{
+    // The brute force count is quadratic, bigger clouds are not verified.
+    const uint maxVerifiedCount = 20000;
+    const uint defaultDimensions[] = { 2 };
+    const uint defaultSizes[] = { 1000, 10000, 100000, 1000000 };
+    const double defaultEpsilonFactors[] = { 1.0, 2.0, 4.0 };
+    params.SetDefaults( MakeList( defaultDimensions ), MakeList( defaultSizes ), MakeList( defaultEpsilonFactors ) );
+    std::cout << std::left << std::setw( 12 ) << "points" << std::right
+              << std::setw( 5 ) << "dim"
+              << std::setw( 10 ) << "count"
+              << std::setw( 12 ) << "epsilon"
+              << std::setw( 14 ) << "edges"
+              << std::setw( 8 ) << "check"
+              << std::setw( 8 ) << "cc"
+              << std::setw( 10 ) << "max win"
+              << std::setw( 10 ) << "mean win"
+              << std::setw( 14 ) << "pair tests"
+              << std::setw( 10 ) << "accept %"
+              << std::setw( 12 ) << "refDist ms"
+              << std::setw( 12 ) << "edges ms"
+              << std::setw( 12 ) << "bfs ms"
+              << std::setw( 12 ) << "peak MB" << std::endl;
+
+    const Metrics &metrics = EuclideanMetrics::Get();
+    const DynArray<uint> &dimensions = params.GetDimensions();
+    const DynArray<uint> &sizes = params.GetSizes();
+    const DynArray<double> &epsilonFactors = params.GetEpsilonFactors();
+    const uint distributionsCount = static_cast<uint>( PointsGenerator::Distribution::Count );
+    bool verified = true;
+    for ( DynArray<uint>::ConstIterator dim = dimensions.Begin(); dim != dimensions.End(); ++dim )
+    {
+        for ( uint dist = 0; dist < distributionsCount; ++dist )
+        {
+            const PointsGenerator::Distribution distribution = static_cast<PointsGenerator::Distribution>( dist );
+            for ( DynArray<double>::ConstIterator factor = epsilonFactors.Begin(); factor != epsilonFactors.End(); ++factor )
+            {
+                // Sizes are expected in ascending order, once a run gets too slow the bigger ones are skipped.
+                bool skip = false;
+                for ( DynArray<uint>::ConstIterator size = sizes.Begin(); size != sizes.End(); ++size )
+                {
+                    std::cout << std::left << std::setw( 12 ) << PointsGenerator::GetName( distribution ) << std::right
+                              << std::setw( 5 ) << *dim;
+                    if ( skip || *size < 2 )
+                    {
+                        std::cout << std::setw( 10 ) << *size << "  skipped" << std::endl;
+                        continue;
+                    }
+                    PointCloud points;
+                    PointsGenerator::Create( distribution, *dim, *size, points );
+                    const uint count = points.GetSize();
+                    const double epsilon = *factor * pow( static_cast<double>( count ), -1.0 / *dim );
+
+                    MemoryUsage::ResetPeak();
+                    PerfCounter pc;
+                    pc.Reset();
+                    RipsComplex rips;
+                    rips.CreateVerts( points );
+                    rips.AssignLabels();
+                    ArenaBuffer<RipsComplex::VertexRefDist> vertsRefDist;
+                    rips.CalculateVertexReferenceDistance( metrics, vertsRefDist );
+                    const double refDistTime = pc.Reset();
+                    rips.CreateEdges( vertsRefDist, metrics, epsilon );
+                    const double edgesTime = pc.Reset();
+                    rips.CreateConnectedComponents();
+                    const double bfsTime = pc.Reset();
+                    skip = ( refDistTime + edgesTime + bfsTime ) > params.GetMaxTime();
+                    const RipsStatistics &statistics = rips.GetStatistics();
+                    const char *check = "-";
+                    if ( count <= maxVerifiedCount )
+                    {
+                        const bool match = CountEdgesBruteForce( points, metrics, epsilon ) == rips.GetEdgesCount();
+                        verified = verified && match;
+                        check = match ? "ok" : "FAIL";
+                    }
+
+                    std::cout << std::setw( 10 ) << count
+                              << std::setw( 12 ) << epsilon
+                              << std::setw( 14 ) << rips.GetEdgesCount()
+                              << std::setw( 8 ) << check
+                              << std::setw( 8 ) << rips.GetConnectedComponentsNumber()
+                              << std::setw( 10 ) << statistics.m_maxWindowSize
+                              << std::fixed << std::setprecision( 2 )
+                              << std::setw( 10 ) << statistics.GetMeanWindowSize()
+                              << std::setw( 14 ) << statistics.m_pairTestsCount
+                              << std::setw( 10 ) << ( statistics.m_pairTestsCount > 0 ? 100.0 * statistics.m_edgesCount / statistics.m_pairTestsCount : 0.0 )
+                              << std::setw( 12 ) << refDistTime * 1e3
+                              << std::setw( 12 ) << edgesTime * 1e3
+                              << std::setw( 12 ) << bfsTime * 1e3
+                              << std::setw( 12 ) << MemoryUsage::GetPeak() / ( 1024.0 * 1024.0 ) << std::endl;
+                    std::cout.unsetf( std::ios_base::floatfield );
+                    std::cout << std::setprecision( 6 );
+
+                    std::ostringstream key;
+                    key << "rips/" << PointsGenerator::GetName( distribution ) << "/dim" << *dim << "/points" << *size << "/eps" << *factor;
+                    results.Add( key.str() + "/CalculateVertexReferenceDistance", "ms", refDistTime * 1e3 );
+                    results.Add( key.str() + "/CreateEdges", "ms", edgesTime * 1e3 );
+                    results.Add( key.str() + "/CreateConnectedComponents", "ms", bfsTime * 1e3 );
+                }
+            }
+        }
+    }
+    return verified;
+}
+
+
+void Benchmarks::RunScaling( BenchmarkParams &params, BenchmarkResults &results )
+{
+    const uint defaultDimensions[] = { 2 };
+    const uint defaultSizes[] = { 100, 200, 400, 800 };
+    const double defaultEpsilonFactors[] = { 1.0 };
+    params.SetDefaults( MakeList( defaultDimensions ), MakeList( defaultSizes ), MakeList( defaultEpsilonFactors ) );
+
+    std::ofstream file;
+    if ( !params.GetOutputFilename().empty() )
+    {
+        file.open( params.GetOutputFilename().c_str() );
+    }
+    std::ostream &output = file.is_open() ? file : std::cout;
+    output << "alg,map,metrics,domain_size,test_size,centers,wall_s,per_center_ms,points_per_restriction,edges_per_complex,pair_tests_per_complex" << std::endl;
+
+    // Test configurations in the TestParams format.
+    const char *maps[] = { "linear2d 1 0.5", "linear_discontinous 1", "horseshoe_u 0", "horseshoe_s 0", "horseshoe_g 0", "translation2d 0.1 0.1" };
+    const char *metrics[] = { "euclidean", "quotient_exit_set" };
+    const uint testDomainSize = 20;
+    const DynArray<uint> &sizes = params.GetSizes();
+    for ( uint algorithmId = 1; algorithmId <= 2; ++algorithmId )
+    {
+        for ( const char *mapParams : maps )
+        {
+            for ( const char *metricsParams : metrics )
+            {
+                bool skip = false;
+                for ( DynArray<uint>::ConstIterator size = sizes.Begin(); size != sizes.End() && !skip; ++size )
+                {
+                    std::ostringstream paramsString;
+                    paramsString << "--alg " << algorithmId << " --domain random " << *size << " --map " << mapParams
+                                 << " --metrics " << metricsParams << " --test random " << testDomainSize << " ";
+                    TestParams testParams( paramsString.str() );
+                    // ExitSetQuotientMetrics needs the map to send the domain into itself.
+                    if ( strcmp( metricsParams, "quotient_exit_set" ) == 0 && testParams.GetDomainDim() != testParams.GetRangeDim() )
+                    {
+                        break;
+                    }
+
+                    Ptr<Domain> domain = testParams.CreateDomain();
+                    Ptr<Noise> noise = testParams.CreateNoise();
+                    Ptr<Map> map = testParams.CreateMap( *domain, noise.Get() );
+                    PerfCounter pc;
+                    pc.Reset();
+                    Ptr<Metrics> domainMetrics = testParams.CreateMetrics( *domain, *map );
+                    Ptr<Metrics> graphMetrics = new MaxDomainRangeMetrics( *domainMetrics, *domainMetrics, domain->GetDimension(), map->GetDimension() );
+                    Ptr<Domain> testDomain = testParams.CreateTestDomain();
+                    DynArray<double> epsilons;
+                    testParams.CreateEpsilons( epsilons );
+
+                    PersistenceData persistenceData;
+                    LocalKernelsPersistence::Statistics statistics;
+                    if ( algorithmId == 1 )
+                    {
+                        LocalKernelsPersistence::Compute_Alg1( *domain, *map, *testDomain, epsilons, testParams.GetRestrictionRadius(), *domainMetrics, *graphMetrics, persistenceData, &statistics );
+                    }
+                    else
+                    {
+                        LocalKernelsPersistence::Compute_Alg2( *domain, *map, testParams.GetAlpha(), testParams.GetBeta(), *domainMetrics, persistenceData, &statistics );
+                    }
+                    const double time = pc.Reset();
+                    skip = time > params.GetMaxTime();
+
+                    const double centers = std::max( 1u, statistics.m_centersCount );
+                    const double complexes = std::max( 1u, statistics.m_complexesCount );
+                    output << algorithmId << "," << mapParams << "," << metricsParams << "," << domain->GetCount() << ","
+                           << ( algorithmId == 1 ? testDomain->GetCount() : 0 ) << "," << statistics.m_centersCount << ","
+                           << time << "," << time * 1e3 / centers << ","
+                           << statistics.m_restrictionPointsCount / centers << "," << statistics.m_complexEdgesCount / complexes << ","
+                           << statistics.m_complexPairTestsCount / complexes << std::endl;
+
+                    std::ostringstream key;
+                    key << "scaling/alg" << algorithmId << "/" << mapParams << "/" << metricsParams << "/size" << *size;
+                    results.Add( key.str(), "ms/center", time * 1e3 / centers );
+                }
+            }
+        }
+    }
+}
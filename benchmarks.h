@@ -0,0 +1,153 @@
+// pbrendel (c) 2021
+
+#pragma once
+
+#include "Core/dynArray.h"
+
+#include <ostream>
+#include <string>
+
+
+class BenchmarkParams
+{
+public:
+
+    BenchmarkParams( int argc, char **argv );
+
+    const std::string &GetName() const
+    {
+        return m_name;
+    }
+
+    const o::DynArray<uint> &GetDimensions() const
+    {
+        return m_dimensions;
+    }
+
+    const o::DynArray<uint> &GetSizes() const
+    {
+        return m_sizes;
+    }
+
+    // Epsilons are given as multiples of the mean spacing of the points.
+    const o::DynArray<double> &GetEpsilonFactors() const
+    {
+        return m_epsilonFactors;
+    }
+
+    constexpr double GetMinTime() const
+    {
+        return m_minTime;
+    }
+
+    constexpr double GetMaxTime() const
+    {
+        return m_maxTime;
+    }
+
+    const std::string &GetOutputFilename() const
+    {
+        return m_outputFilename;
+    }
+
+    constexpr uint GetRepeatCount() const
+    {
+        return m_repeatCount;
+    }
+
+    const std::string &GetJsonFilename() const
+    {
+        return m_jsonFilename;
+    }
+
+    const std::string &GetBaselineFilename() const
+    {
+        return m_baselineFilename;
+    }
+
+    // Relative slowdown of the median below which differences are never reported.
+    constexpr double GetThreshold() const
+    {
+        return m_threshold;
+    }
+
+    void SetDefaults( const o::DynArray<uint> &dimensions, const o::DynArray<uint> &sizes, const o::DynArray<double> &epsilonFactors );
+
+private:
+
+    bool ParseUintList( int argc, char **argv, int &index, o::DynArray<uint> &outValues ) const;
+    bool ParseDoubleList( int argc, char **argv, int &index, o::DynArray<double> &outValues ) const;
+
+    std::string m_name;
+    o::DynArray<uint> m_dimensions;
+    o::DynArray<uint> m_sizes;
+    o::DynArray<double> m_epsilonFactors;
+    double m_minTime;
+    double m_maxTime;
+    std::string m_outputFilename;
+    uint m_repeatCount;
+    std::string m_jsonFilename;
+    std::string m_baselineFilename;
+    double m_threshold;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Samples of named measurements collected over repeated benchmark runs. Results are stored
+// as JSON with one benchmark per line, Read accepts only files written by Write.
+class BenchmarkResults
+{
+public:
+
+    void Add( const std::string &name, const char *unit, double value );
+    // Computes the medians and deviations of the samples, called once all of them are added.
+    void UpdateStatistics();
+
+    bool Write( const std::string &filename ) const;
+    // Returns false if the file cannot be opened or has no entries.
+    bool Read( const std::string &filename );
+
+    // Prints the comparison with the baseline and returns the number of significant slowdowns
+    // plus the number of baseline benchmarks missing from these results.
+    uint Compare( const BenchmarkResults &baseline, double threshold, std::ostream &str ) const;
+
+private:
+
+    struct Entry
+    {
+        std::string m_name;
+        std::string m_unit;
+        o::DynArray<double> m_samples;
+        double m_median;
+        double m_mad;
+    };
+
+    Entry *Find( const std::string &name );
+    const Entry *Find( const std::string &name ) const;
+    static void UpdateStatistics( Entry &entry );
+
+    o::DynArray<Entry> m_entries;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class Benchmarks
+{
+public:
+
+    static bool IsBenchmarkCommand( int argc, char **argv );
+    // Returns non zero if a regression against the baseline or a missing benchmark was found.
+    static int Run( int argc, char **argv );
+
+private:
+
+    enum : uint
+    {
+        RANDOM_SEED = 1,
+    };
+
+    static void RunMetrics( BenchmarkParams &params, BenchmarkResults &results );
+    // Returns false if the edges of a complex differ from the brute force count.
+    static bool RunRips( BenchmarkParams &params, BenchmarkResults &results );
+    static void RunScaling( BenchmarkParams &params, BenchmarkResults &results );
+};
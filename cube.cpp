@@ -4,7 +4,7 @@
 #include "point.h"
 
 
-bool Cube::IsInside( const Point &p ) const
+bool Cube::IsInside( ConstPointView p ) const
 {
     if ( m_intervals.GetSize() != p.GetDimension() )
     {
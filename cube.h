@@ -5,7 +5,7 @@
 #include "interval.h"
 #include "Core/dynArray.h"
 
-class Point;
+class ConstPointView;
 
 
 class Cube
@@ -42,7 +42,7 @@ public:
 		return m_intervals[index];
 	}
 
-    bool IsInside( const Point &p ) const;
+    bool IsInside( ConstPointView p ) const;
 
 private:
 
@@ -60,12 +60,30 @@ public:
         str << persistenceData.m_quality<< " " << persistenceData.m_discontinuity << std::endl;
     }
 
+    static void Write( std::ostream &str, const PersistenceCostWriter &wr )
+    {
+        const PointPersistenceData &persistenceData = wr.m_persistenceData;
+        const PointPersistenceData::Cost &cost = persistenceData.m_cost;
+        str << persistenceData.m_argument << persistenceData.m_value;
+        str << persistenceData.m_quality<< " " << persistenceData.m_discontinuity << " ";
+        str << cost.m_time * 1e3 << " " << cost.m_restrictionSize << " " << cost.m_domainEdgesCount << " " << cost.m_graphEdgesCount << std::endl;
+    }
+
     static void Write( std::ostream &str, const RipsComplex &rips )
     {
         const RipsComplex::Vertex *verts = rips.m_verts.Get();
+        Point p( rips.m_points->GetDimension() );
+        Point r( rips.m_rangePoints != nullptr ? rips.m_rangePoints->GetDimension() : 0 );
         for ( uint i = 0; i < rips.m_vertsCount; ++i )
         {
-            str << verts[i].m_label << " = " << *verts[i].m_point << std::endl;
+            rips.m_points->GetValue( verts[i].m_pointIndex, p );
+            str << verts[i].m_label << " = " << p;
+            if ( rips.m_rangePoints != nullptr )
+            {
+                rips.m_rangePoints->GetValue( verts[i].m_pointIndex, r );
+                str << r;
+            }
+            str << std::endl;
         }
         const uint edgesCount = rips.m_edges.GetSize();
         for ( uint i = 0; i < edgesCount; ++i )
@@ -169,6 +187,13 @@ std::ostream &operator<<( std::ostream &str, const Noise &noise )
     return str;
 }
 
+std::ostream &operator<<( std::ostream &str, const PersistenceCostWriter &wr )
+{
+    DataWriter::Write( str, wr );
+    return str;
+}
+
+
 std::ostream &operator<<( std::ostream &str, const PersistenceDiagram &persistenceDiagram )
 {
     DataWriter::Write( str, persistenceDiagram );
@@ -197,3 +222,17 @@ std::ostream &operator<<( std::ostream &str, const RipsComplex &rips )
     DataWriter::Write( str, rips );
     return str;
 }
+
+
+std::ostream &operator<<( std::ostream &str, const RipsStatistics &statistics )
+{
+    str << "windows: " << statistics.m_windowsCount << std::endl;
+    str << "window size max: " << statistics.m_maxWindowSize << " mean: " << statistics.GetMeanWindowSize() << std::endl;
+    str << "pair tests: " << statistics.m_pairTestsCount << std::endl;
+    str << "edges: " << statistics.m_edgesCount << std::endl;
+    str << "accepted pairs: " << ( statistics.m_pairTestsCount > 0 ? 100.0 * statistics.m_edgesCount / statistics.m_pairTestsCount : 0.0 ) << "%" << std::endl;
+    str << "vertex degree: " << statistics.m_vertexDegree << std::endl;
+    str << "edges bytes: " << statistics.m_edgesBytes << std::endl;
+    str << "neighbours bytes: " << statistics.m_neighboursBytes << std::endl;
+    return str;
+}
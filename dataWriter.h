@@ -13,6 +13,7 @@ class PersistenceDiagram;
 class Point;
 class PointPersistenceData;
 class RipsComplex;
+struct RipsStatistics;
 
 
 struct MapWriter
@@ -27,6 +28,17 @@ struct MapWriter
 };
 
 
+// Writes the persistence data followed by the cost columns: time in ms, restriction size, domain and graph edges.
+struct PersistenceCostWriter
+{
+    PersistenceCostWriter( const PointPersistenceData &persistenceData )
+        : m_persistenceData( persistenceData )
+    {}
+
+    const PointPersistenceData &m_persistenceData;
+};
+
+
 struct MapValuesWriter
 {
     MapValuesWriter( const Domain &domain, const Map &map )
@@ -45,7 +57,9 @@ std::ostream &operator<<( std::ostream &str, const HorseshoeExitSetQuotientMetri
 std::ostream &operator<<( std::ostream &str, const MapWriter &wr );
 std::ostream &operator<<( std::ostream &str, const MapValuesWriter &wr );
 std::ostream &operator<<( std::ostream &str, const Noise &noise );
+std::ostream &operator<<( std::ostream &str, const PersistenceCostWriter &wr );
 std::ostream &operator<<( std::ostream &str, const PersistenceDiagram &persistenceDiagram );
 std::ostream &operator<<( std::ostream &str, const Point &point );
 std::ostream &operator<<( std::ostream &str, const PointPersistenceData &persistenceData );
 std::ostream &operator<<( std::ostream &str, const RipsComplex &rips );
+std::ostream &operator<<( std::ostream &str, const RipsStatistics &statistics );
@@ -1,8 +1,14 @@
 // pbrendel (c) 2013-21
 
 #include "domain.h"
+#include "fixedDistance.h"
 #include "metrics.h"
 #include "noise.h"
+#include "hardwareCounters.h"
+#include "instrumentedMetrics.h"
+#include "profiler.h"
+#include "spaceFillingCurve.h"
+#include "trace.h"
 #include "Core/assert.h"
 
 #include <algorithm>
@@ -10,6 +16,18 @@
 using o::DynArray;
 
 
+void Domain::GetValues( PointCloud &outPoints ) const
+{
+    const uint count = GetCount();
+    outPoints.Reset( GetDimension(), count );
+    outPoints.SetBounds( m_cube );
+    Point p( GetDimension() );
+    for ( uint i = 0; i < count; ++i )
+    {
+        GetValue( i, p );
+        outPoints.Set( i, p );
+    }
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -17,8 +35,8 @@ UniformCube::UniformCube( const Cube &cube, const DynArray<uint> &resolution, No
     : Domain( cube, noise )
     , m_resolution( resolution )
 {
-    m_count = 0;
-    for ( uint i = 1; i < resolution.GetSize(); ++i )
+    m_count = 1;
+    for ( uint i = 0; i < resolution.GetSize(); ++i )
     {
         m_count *= resolution[i];
     }
@@ -44,7 +62,7 @@ void UniformCube::GetValue( uint index, Point &p ) const
 
 ////////////////////////////////////////////////////////////////////////////////
 
-bool UniformCubeWithHole::IsInDomain( const Point &p ) const
+bool UniformCubeWithHole::IsInDomain( ConstPointView p ) const
 {
     if ( !Domain::IsInDomain( p ) )
     {
@@ -81,6 +99,7 @@ void UniformCubeWithHole::GetValue( uint index, Point &p ) const
 RandomCube::RandomCube( const Cube &cube, uint count, Noise *noise )
     : Domain( cube, noise )
     , m_randoms( cube.GetDimension() * count )
+    , m_randomsFootprint( MemoryFootprint::Category::RandomCube, cube.GetDimension() * count * sizeof( double ) )
 {
     m_count = count;
     const uint size = m_randoms.GetSize();
@@ -109,7 +128,7 @@ void RandomCube::GetValue( uint index, Point &p ) const
 
 ////////////////////////////////////////////////////////////////////////////////
 
-bool RandomCubeWithHole::IsInDomain( const Point &p ) const
+bool RandomCubeWithHole::IsInDomain( ConstPointView p ) const
 {
     if ( !Domain::IsInDomain( p ) )
     {
@@ -142,15 +161,66 @@ void RandomCubeWithHole::GetValue( uint index, Point &p ) const
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Points are taken once from the other domain, so that the noise is not sampled again on every access.
+ReorderedDomain::ReorderedDomain( Domain *other )
+    : Domain( *other )
+    , m_domain( other )
+    , m_points( PointCloud::Precision::Double )
+    , m_pointsFootprint( MemoryFootprint::Category::PointCloud )
+{
+    ProfileScope scope( "ReorderedDomain" );
+    PointCloud points( PointCloud::Precision::Double );
+    other->GetValues( points );
+    CreateMortonOrder( points, m_cube, m_permutation );
+    m_points.Gather( points, m_permutation );
+    m_count = m_points.GetSize();
+    m_pointsFootprint.Update( m_points.GetMemoryFootprint() + m_permutation.GetSize() * sizeof( uint ) );
+}
+
+
+void ReorderedDomain::GetValue( uint index, Point &p ) const
+{
+    m_points.GetValue( index, p );
+}
+
+
+void ReorderedDomain::GetValues( PointCloud &outPoints ) const
+{
+    if ( outPoints.GetPrecision() == m_points.GetPrecision() )
+    {
+        outPoints = m_points;
+        return;
+    }
+    Domain::GetValues( outPoints );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct DomainRestriction::CreateIndicesVisitor
+{
+    DomainRestriction &m_restriction;
+    const Point &m_center;
+    double m_radius;
+
+    template <class Distance>
+    void Visit( const Distance &distance )
+    {
+        m_restriction.CreateIndices( distance, m_center, m_radius );
+    }
+};
+
+
 void DomainRestriction::GetValue( uint index, Point &p ) const
 {
     const uint dim = GetDimension();
     assert( p.GetDimension() == dim );
-    assert( index < m_points.GetSize() );
-    for ( uint i = 0; i < dim; ++i )
+    if ( IsIndexRestriction() )
     {
-        p[i] = m_points[index][i];
+        assert( index < m_count );
+        m_otherPoints->GetValue( m_indices[index], p );
+        return;
     }
+    m_points.GetValue( index, p );
     if ( m_noise != nullptr )
     {
         m_noise->AddNoise( p );
@@ -158,20 +228,98 @@ void DomainRestriction::GetValue( uint index, Point &p ) const
 }
 
 
+void DomainRestriction::GetValues( PointCloud &outPoints ) const
+{
+    if ( IsIndexRestriction() )
+    {
+        outPoints.Gather( *m_otherPoints, m_indices.Get(), m_count );
+        return;
+    }
+    if ( m_noise != nullptr )
+    {
+        Domain::GetValues( outPoints );
+        return;
+    }
+    outPoints = m_points;
+}
+
+
 void DomainRestriction::Create( const Domain &other, const Metrics &metrics, const Point &center, double radius )
 {
+    ProfileScope scope( "DomainRestriction::Create" );
+    TraceScope trace( "Restriction" );
+    HardwareCounterScope counters( "DomainRestriction::Create" );
     const uint dim = GetDimension();
     assert( center.GetDimension() == dim );
-    m_points.Clear();
+    m_points.Reset( dim, 0 );
+    m_points.SetBounds( m_cube );
     Point p( dim );
     const uint count = other.GetCount();
+    counters.SetItems( count );
     for ( uint i = 0; i < count; ++i )
     {
         other.GetValue( i, p );
-        if ( metrics.GetDistance( p, center, i, Metrics::NO_INDEX ) <= radius )
+        if ( metrics.WithinDistance( p, center, i, Metrics::NO_INDEX, radius ) )
         {
             m_points.PushBack( p );
         }
     }
     m_count = m_points.GetSize();
+    m_pointsFootprint.Update( m_points.GetMemoryFootprint() );
+    trace.AddArg( "points", m_count );
+}
+
+
+template <class Distance>
+void DomainRestriction::CreateIndices( const Distance &distance, const Point &center, double radius )
+{
+    const typename Distance::PointType c( center );
+    const uint count = m_otherPoints->GetSize();
+    uint indices[Metrics::BATCH_SIZE];
+    uint32_t mask[Metrics::BATCH_SIZE / 32];
+    for ( uint first = 0; first < count; first += Metrics::BATCH_SIZE )
+    {
+        const uint blockCount = std::min( count - first, static_cast<uint>( Metrics::BATCH_SIZE ) );
+        for ( uint k = 0; k < blockCount; ++k )
+        {
+            indices[k] = first + k;
+        }
+        distance.GetWithinDistance( c, Metrics::NO_INDEX, indices, blockCount, radius, mask );
+#ifndef NDEBUG
+        // The check is not a part of the computation, the instrumented metrics do not count it.
+        const MetricsStatisticsSuspendScope suspend;
+        for ( uint k = 0; k < blockCount; ++k )
+        {
+            const bool within = ( mask[k / 32] & ( 1u << ( k % 32 ) ) ) != 0;
+            assertex( within == distance.WithinDistance( distance.Load( indices[k] ), c, indices[k], Metrics::NO_INDEX, radius ), "Restriction metrics are not symmetric" );
+        }
+#endif
+        for ( uint k = 0; k < blockCount; ++k )
+        {
+            if ( ( mask[k / 32] & ( 1u << ( k % 32 ) ) ) == 0 )
+            {
+                continue;
+            }
+            if ( m_count == m_indices.GetSize() )
+            {
+                m_indices.Resize( std::max( 16u, m_count * 2 ) );
+            }
+            m_indices[m_count++] = first + k;
+        }
+    }
+}
+
+
+void DomainRestriction::Create( const PointCloud &otherPoints, const Metrics &metrics, const Point &center, double radius )
+{
+    ProfileScope scope( "DomainRestriction::Create" );
+    TraceScope trace( "Restriction" );
+    HardwareCounterScope counters( "DomainRestriction::Create" );
+    assert( center.GetDimension() == GetDimension() && otherPoints.GetDimension() == GetDimension() );
+    m_count = 0;
+    counters.SetItems( otherPoints.GetSize() );
+    CreateIndicesVisitor visitor = { *this, center, radius };
+    DispatchDistance( otherPoints, metrics, visitor );
+    m_pointsFootprint.Update( m_indices.GetSize() * sizeof( uint ) );
+    trace.AddArg( "points", m_count );
 }
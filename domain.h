@@ -3,7 +3,10 @@
 #pragma once
 
 #include "cube.h"
-#include "point.h"
+#include "arena.h"
+#include "memoryFootprint.h"
+#include "pointCloud.h"
+#include "Core/ptr.h"
 
 class Noise;
 class Metrics;
@@ -48,13 +51,16 @@ public:
         return m_cube[dim];
     }
 
-    virtual bool IsInDomain( const Point &p ) const
+    virtual bool IsInDomain( ConstPointView p ) const
     {
         return m_cube.IsInside( p );
     }
 
     virtual void GetValue( uint index, Point &p ) const = 0;
 
+    // Fills the cloud with all the points of the domain.
+    virtual void GetValues( PointCloud &outPoints ) const;
+
 protected:
 
     uint m_count;
@@ -88,7 +94,7 @@ public:
         , m_hole( hole )
     {}
 
-    virtual bool IsInDomain( const Point &p ) const override;
+    virtual bool IsInDomain( ConstPointView p ) const override;
     virtual void GetValue( uint index, Point &p ) const override;
 
 private:
@@ -109,6 +115,7 @@ public:
 protected:
 
     o::DynArray<double> m_randoms;
+    MemoryFootprintScope m_randomsFootprint;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -122,7 +129,7 @@ public:
         , m_hole( hole )
     {}
 
-    virtual bool IsInDomain( const Point &p ) const override;
+    virtual bool IsInDomain( ConstPointView p ) const override;
     virtual void GetValue( uint index, Point &p ) const override;
 
 private:
@@ -132,21 +139,92 @@ private:
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Points of the other domain ordered along the Morton curve, so that consecutive points are close
+// to each other. Takes the ownership of the other domain.
+class ReorderedDomain : public Domain
+{
+public:
+
+    explicit ReorderedDomain( Domain *other );
+
+    virtual bool IsInDomain( ConstPointView p ) const override
+    {
+        return m_domain->IsInDomain( p );
+    }
+
+    virtual void GetValue( uint index, Point &p ) const override;
+    virtual void GetValues( PointCloud &outPoints ) const override;
+
+    // Element i is the index in the other domain of point i.
+    const o::DynArray<uint> &GetPermutation() const
+    {
+        return m_permutation;
+    }
+
+private:
+
+    o::Ptr<Domain> m_domain;
+    o::DynArray<uint> m_permutation;
+    PointCloud m_points;
+    MemoryFootprintScope m_pointsFootprint;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Points of the other domain within the radius from the center. The points are either copied or,
+// if the points of the other domain are given as a cloud, referred to by their indices in the cloud.
 class DomainRestriction : public Domain
 {
 public:
 
     DomainRestriction( const Domain &other, const Metrics &metrics, const Point &center, double radius )
         : Domain( other )
+        , m_otherPoints( nullptr )
+        , m_pointsFootprint( MemoryFootprint::Category::PointCloud )
     {
         Create( other, metrics, center, radius );
     }
 
+    // The cloud has to hold all the points of the other domain and outlive the restriction. Points
+    // are taken from the cloud as they are, noise is not added again. Distances are taken from the
+    // center in batches, so the metrics have to be symmetric to select the same points as the copying
+    // restriction, which measures them from each point. Debug builds assert it.
+    DomainRestriction( const Domain &other, const PointCloud &otherPoints, const Metrics &metrics, const Point &center, double radius )
+        : Domain( other )
+        , m_otherPoints( &otherPoints )
+        , m_pointsFootprint( MemoryFootprint::Category::PointCloud )
+    {
+        assert( otherPoints.GetSize() == other.GetCount() );
+        Create( otherPoints, metrics, center, radius );
+    }
+
+    bool IsIndexRestriction() const
+    {
+        return m_otherPoints != nullptr;
+    }
+
+    // Indices of the points in the cloud of the other domain, GetCount() of them.
+    const uint *GetIndices() const
+    {
+        assert( IsIndexRestriction() );
+        return m_indices.Get();
+    }
+
     virtual void GetValue( uint index, Point &p ) const override;
+    virtual void GetValues( PointCloud &outPoints ) const override;
 
 private:
 
-    void Create( const Domain &other, const Metrics &metrics, const Point &center, double radius );
+    struct CreateIndicesVisitor;
 
-    PointsList m_points;
+    void Create( const Domain &other, const Metrics &metrics, const Point &center, double radius );
+    void Create( const PointCloud &otherPoints, const Metrics &metrics, const Point &center, double radius );
+    template <class Distance>
+    void CreateIndices( const Distance &distance, const Point &center, double radius );
+
+    PointCloud m_points;
+    const PointCloud *m_otherPoints;
+    // Taken from the current arena, see ArenaScope. Capacity grows twice when exceeded.
+    ArenaBuffer<uint> m_indices;
+    MemoryFootprintScope m_pointsFootprint;
 };
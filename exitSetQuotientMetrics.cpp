@@ -3,16 +3,26 @@
 #include "exitSetQuotientMetrics.h"
 #include "domain.h"
 #include "map.h"
+#include "hardwareCounters.h"
+#include "profiler.h"
+#include "Core/defs.h"
 
+#include <algorithm>
 #include <limits>
 
 
 ExitSetQuotientMetrics::ExitSetQuotientMetrics( const Domain &domain, const Map &map, const Metrics &innerMetrics )
-    : m_domain( domain )
+    : m_points( PointCloud::Precision::Double )
+    , m_exitSetPoints( PointCloud::Precision::Double )
+    , m_domain( domain )
     , m_innerMetrics( innerMetrics )
+    , m_footprint( MemoryFootprint::Category::ExitSetQuotientMetrics )
 {
+    ProfileScope scope( "ExitSetQuotientMetrics" );
+    HardwareCounterScope counters( "ExitSetQuotientMetrics" );
     assert( !innerMetrics.IsIndexMetrics() );
     const uint domainSize = domain.GetCount();
+    counters.SetItems( domainSize );
     if ( domainSize == 0 )
     {
         return;
@@ -27,11 +37,13 @@ ExitSetQuotientMetrics::ExitSetQuotientMetrics( const Domain &domain, const Map
         map.GetValue( p, v );
         if ( domain.IsInDomain( v ) )
         {
-            m_points.PushBack( MyPoint( p ) );
+            m_points.PushBack( p );
+            m_distances.PushBack( std::numeric_limits<double>::max() );
             map.GetValue( v, v1 );
             if ( domain.IsInDomain( v1 ) )
             {
-                m_points.PushBack( MyPoint( v ) );
+                m_points.PushBack( v );
+                m_distances.PushBack( std::numeric_limits<double>::max() );
             }
             else
             {
@@ -45,21 +57,16 @@ ExitSetQuotientMetrics::ExitSetQuotientMetrics( const Domain &domain, const Map
     }
     // Finally, for all non-exit set points, find nearest exit set point 
     // and store the distance.
-    for ( MyPointsList::Iterator it = m_points.Begin(); it != m_points.End(); ++it )
+    const uint pointsCount = m_points.GetSize();
+    for ( uint i = 0; i < pointsCount; ++i )
     {
-        for ( PointsList::Iterator it1 = m_exitSetPoints.Begin(); it1 != m_exitSetPoints.End(); ++it1 )
-        {
-            const double distance = innerMetrics.GetDistance( it->m_point, *it1, Metrics::NO_INDEX, Metrics::NO_INDEX );
-            if ( distance < it->m_distance )
-            {
-                it->m_distance = distance;
-            }
-        }
+        m_distances[i] = FindExitSetDistance( m_points[i] );
     }
+    m_footprint.Update( m_points.GetMemoryFootprint() + m_distances.GetSize() * sizeof( double ) + m_exitSetPoints.GetMemoryFootprint() );
 }
 
 
-double ExitSetQuotientMetrics::GetDistance( const Point &x, const Point &y, uint, uint ) const
+double ExitSetQuotientMetrics::GetDistance( ConstPointView x, ConstPointView y, uint, uint ) const
 {
     const double dx = GetDistanceToExitSet( x );
     const double dy = GetDistanceToExitSet( y );
@@ -71,7 +78,33 @@ double ExitSetQuotientMetrics::GetDistance( const Point &x, const Point &y, uint
 }
 
 
-o::Ptr<IndexMetrics> ExitSetQuotientMetrics::CreateIndexMetrics( const PointsList &points ) const
+void ExitSetQuotientMetrics::GetDistances( ConstPointView x, uint, const PointCloud &points, const uint *indices, uint count, double *outDistances ) const
+{
+    m_innerMetrics.GetDistances( x, Metrics::NO_INDEX, points, indices, count, outDistances );
+    const double dx = GetDistanceToExitSet( x );
+    for ( uint k = 0; k < count; ++k )
+    {
+        const double dy = GetDistanceToExitSet( points[indices[k]] );
+        outDistances[k] = ( dx == 0 || dy == 0 ) ? dx + dy : std::min( dx + dy, outDistances[k] );
+    }
+}
+
+
+// The distance is the minimum of the path through the exit set and the inner distance, the
+// latter is not needed if the former is within the threshold.
+bool ExitSetQuotientMetrics::WithinDistance( ConstPointView x, ConstPointView y, uint, uint, double threshold ) const
+{
+    const double dx = GetDistanceToExitSet( x );
+    const double dy = GetDistanceToExitSet( y );
+    if ( dx == 0 || dy == 0 || dx + dy <= threshold )
+    {
+        return dx + dy <= threshold;
+    }
+    return m_innerMetrics.WithinDistance( x, y, Metrics::NO_INDEX, Metrics::NO_INDEX, threshold );
+}
+
+
+o::Ptr<IndexMetrics> ExitSetQuotientMetrics::CreateIndexMetrics( const PointCloud &points ) const
 {
     return new ExitSetQuotientIndexMetrics( points, *this );
 }
@@ -90,77 +123,81 @@ double ExitSetQuotientMetrics::AddPoint( const Point &p, const Map &map )
         m_exitSetPoints.PushBack( p );
         return 0.0;
     }
-    MyPoint p1( p );
-    for ( PointsList::Iterator it = m_exitSetPoints.Begin(); it != m_exitSetPoints.End(); ++it )
-    {
-        const double distance = m_innerMetrics.GetDistance( p, *it, Metrics::NO_INDEX, Metrics::NO_INDEX );
-        if ( distance < p1.m_distance )
-        {
-            p1.m_distance = distance;
-        }
-    }
-    m_points.PushBack( p1 );
-    return p1.m_distance;
+    const double pointDistance = FindExitSetDistance( p );
+    m_points.PushBack( p );
+    m_distances.PushBack( pointDistance );
+    return pointDistance;
 }
 
 
-bool ExitSetQuotientMetrics::IsInExitSet( const Point &p ) const
+bool ExitSetQuotientMetrics::IsInExitSet( ConstPointView p ) const
 {
     if ( !m_domain.IsInDomain( p ) )
     {
         return true;
     }
-    for ( MyPointsList::ConstIterator it = m_points.Begin(); it != m_points.End(); ++it )
-    {
-        if ( it->Equals( p ) )
-        {
-            return false;
-        }
-    }
-    return true;
+    return FindPoint( p ) == O_INVALID_INDEX;
 }
 
 
-double ExitSetQuotientMetrics::GetDistanceToExitSet( const Point &p ) const
+double ExitSetQuotientMetrics::GetDistanceToExitSet( ConstPointView p ) const
 {
     if ( !m_domain.IsInDomain( p ) )
     {
         return 0.0;
     }
-    for ( MyPointsList::ConstIterator it = m_points.Begin(); it != m_points.End(); ++it )
-    {
-        if ( it->Equals( p ) )
-        {
-            return it->m_distance;
-        }
-    }
-    return 0.0;
+    const uint index = FindPoint( p );
+    return index != O_INVALID_INDEX ? m_distances[index] : 0.0;
 }
 
-//////////////////////////////////////////////////////////////////////////
 
-ExitSetQuotientMetrics::MyPoint::MyPoint( const Point &point )
-    : m_point( point )
-    , m_distance( std::numeric_limits<double>::max() )
+uint ExitSetQuotientMetrics::FindPoint( ConstPointView p ) const
 {
+    const uint count = m_points.GetSize();
+    for ( uint i = 0; i < count; ++i )
+    {
+        if ( m_points[i] == p )
+        {
+            return i;
+        }
+    }
+    return O_INVALID_INDEX;
 }
 
 
-bool ExitSetQuotientMetrics::MyPoint::Equals( const Point &point ) const
+// Distance to the nearest exit set point, the inner metrics are not index metrics.
+double ExitSetQuotientMetrics::FindExitSetDistance( ConstPointView p ) const
 {
-    return m_point == point;
+    uint indices[BATCH_SIZE];
+    double distances[BATCH_SIZE];
+    double minDistance = std::numeric_limits<double>::max();
+    const uint exitSetPointsCount = m_exitSetPoints.GetSize();
+    for ( uint first = 0; first < exitSetPointsCount; first += BATCH_SIZE )
+    {
+        const uint blockCount = std::min( exitSetPointsCount - first, static_cast<uint>( BATCH_SIZE ) );
+        for ( uint k = 0; k < blockCount; ++k )
+        {
+            indices[k] = first + k;
+        }
+        m_innerMetrics.GetDistances( p, Metrics::NO_INDEX, m_exitSetPoints, indices, blockCount, distances );
+        for ( uint k = 0; k < blockCount; ++k )
+        {
+            minDistance = std::min( minDistance, distances[k] );
+        }
+    }
+    return minDistance;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-ExitSetQuotientIndexMetrics::ExitSetQuotientIndexMetrics( const PointsList &points, const ExitSetQuotientMetrics &metrics )
+ExitSetQuotientIndexMetrics::ExitSetQuotientIndexMetrics( const PointCloud &points, const ExitSetQuotientMetrics &metrics )
     : m_metrics( metrics )
 {
     ResetIndexMetrics( points );
 }
 
 
-double ExitSetQuotientIndexMetrics::GetDistance( const Point &x, const Point &y, uint i, uint j ) const
+double ExitSetQuotientIndexMetrics::GetDistance( ConstPointView x, ConstPointView y, uint i, uint j ) const
 {
     assert( i == Metrics::NO_INDEX || i < m_distanceToExitSet.GetSize() );
     assert( j == Metrics::NO_INDEX || j < m_distanceToExitSet.GetSize() );
@@ -174,7 +211,35 @@ double ExitSetQuotientIndexMetrics::GetDistance( const Point &x, const Point &y,
 }
 
 
-void ExitSetQuotientIndexMetrics::ResetIndexMetrics( const PointsList &points )
+void ExitSetQuotientIndexMetrics::GetDistances( ConstPointView x, uint i, const PointCloud &points, const uint *indices, uint count, double *outDistances ) const
+{
+    assert( i == Metrics::NO_INDEX || i < m_distanceToExitSet.GetSize() );
+    assert( points.GetSize() == m_distanceToExitSet.GetSize() );
+    m_metrics.GetInnerMetrics().GetDistances( x, i, points, indices, count, outDistances );
+    const double d1 = i != Metrics::NO_INDEX ? m_distanceToExitSet[i] : m_metrics.GetDistanceToExitSet( x );
+    for ( uint k = 0; k < count; ++k )
+    {
+        const double d2 = m_distanceToExitSet[indices[k]];
+        outDistances[k] = ( d1 == 0 || d2 == 0 ) ? d1 + d2 : std::min( d1 + d2, outDistances[k] );
+    }
+}
+
+
+bool ExitSetQuotientIndexMetrics::WithinDistance( ConstPointView x, ConstPointView y, uint i, uint j, double threshold ) const
+{
+    assert( i == Metrics::NO_INDEX || i < m_distanceToExitSet.GetSize() );
+    assert( j == Metrics::NO_INDEX || j < m_distanceToExitSet.GetSize() );
+    double d1 = i != Metrics::NO_INDEX ? m_distanceToExitSet[i] : m_metrics.GetDistanceToExitSet( x );
+    double d2 = j != Metrics::NO_INDEX ? m_distanceToExitSet[j] : m_metrics.GetDistanceToExitSet( y );
+    if ( d1 == 0 || d2 == 0 || d1 + d2 <= threshold )
+    {
+        return d1 + d2 <= threshold;
+    }
+    return m_metrics.GetInnerMetrics().WithinDistance( x, y, i, j, threshold );
+}
+
+
+void ExitSetQuotientIndexMetrics::ResetIndexMetrics( const PointCloud &points )
 {
     m_distanceToExitSet.Clear();
     const uint size = points.GetSize();
@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include "memoryFootprint.h"
 #include "metrics.h"
 
 class Domain;
@@ -14,11 +15,14 @@ public:
 
     ExitSetQuotientMetrics( const Domain &domain, const Map &map, const Metrics& innerMetrics );
 
-    virtual double GetDistance( const Point &x, const Point &y, uint, uint ) const override;
+    virtual double GetDistance( ConstPointView x, ConstPointView y, uint, uint ) const override;
+    virtual void GetDistances( ConstPointView x, uint, const PointCloud &points, const uint *indices, uint count, double *outDistances ) const override;
+    virtual bool WithinDistance( ConstPointView x, ConstPointView y, uint, uint, double threshold ) const override;
     virtual bool HasIndexMetrics() const override { return true; }
-    virtual o::Ptr<IndexMetrics> CreateIndexMetrics( const PointsList &points ) const override;
+    virtual bool RequiresDoublePrecision() const override { return true; }
+    virtual o::Ptr<IndexMetrics> CreateIndexMetrics( const PointCloud &points ) const override;
 
-    double GetDistanceToExitSet( const Point &p ) const;
+    double GetDistanceToExitSet( ConstPointView p ) const;
 
     const Metrics &GetInnerMetrics() const
     {
@@ -27,25 +31,19 @@ public:
 
 private:
 
-    struct MyPoint
-    {
-        Point m_point;
-        double m_distance;
-
-        MyPoint( const Point &point );
-
-        bool Equals( const Point &point ) const;
-    };
-
-    typedef o::DynArray<MyPoint> MyPointsList;
-
     double AddPoint( const Point &p, const Map &map );
-    bool IsInExitSet( const Point &p ) const;
-
-    MyPointsList m_points;
-    PointsList m_exitSetPoints;
+    bool IsInExitSet( ConstPointView p ) const;
+    uint FindPoint( ConstPointView p ) const;
+    double FindExitSetDistance( ConstPointView p ) const;
+
+    // Points mapped into the domain with their distances to the exit set. The clouds are always
+    // double precision, as FindPoint looks the points up by exact coordinates.
+    PointCloud m_points;
+    o::DynArray<double> m_distances;
+    PointCloud m_exitSetPoints;
     const Domain &m_domain;
     const Metrics &m_innerMetrics;
+    MemoryFootprintScope m_footprint;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -54,10 +52,12 @@ class ExitSetQuotientIndexMetrics : public IndexMetrics
 {
 public:
 
-    ExitSetQuotientIndexMetrics( const PointsList &points, const ExitSetQuotientMetrics &metrics );
+    ExitSetQuotientIndexMetrics( const PointCloud &points, const ExitSetQuotientMetrics &metrics );
 
-    virtual double GetDistance( const Point &x, const Point &y, uint i, uint j ) const override;
-    virtual void ResetIndexMetrics( const PointsList &points ) override;
+    virtual double GetDistance( ConstPointView x, ConstPointView y, uint i, uint j ) const override;
+    virtual void GetDistances( ConstPointView x, uint i, const PointCloud &points, const uint *indices, uint count, double *outDistances ) const override;
+    virtual bool WithinDistance( ConstPointView x, ConstPointView y, uint i, uint j, double threshold ) const override;
+    virtual void ResetIndexMetrics( const PointCloud &points ) override;
 
     void AddPoint( double distance )
     {
@@ -0,0 +1,430 @@
+// pbrendel (c) 2021
+
+#pragma once
+
+#include "fixedPoint.h"
+#include "metrics.h"
+#include "pointCloud.h"
+#include "simdDistance.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+// Set to 0 to evaluate all the distances through the virtual Metrics interface.
+#ifndef FIXED_DIMENSION_KERNELS
+#define FIXED_DIMENSION_KERNELS 1
+#endif
+
+
+// Distances between the points of a cloud. Loops load a point once with Load and pass it to
+// GetDistance, so the same code runs with the virtual metrics and with the fixed dimension kernels.
+// GetDistances and GetWithinDistance take the other points by indices, see Metrics::GetDistances.
+// WithinDistance answers GetDistance( x, y, i, j ) <= threshold, usually with less work.
+class GenericDistance
+{
+public:
+
+    typedef Point PointType;
+
+    GenericDistance( const PointCloud &points, const Metrics &metrics )
+        : m_points( points )
+        , m_metrics( metrics )
+    {}
+
+    // Loaded points are copied, so clouds of any precision are read the same way.
+    Point Load( uint index ) const
+    {
+        Point p( m_points.GetDimension() );
+        m_points.GetValue( index, p );
+        return p;
+    }
+
+    double GetDistance( ConstPointView x, ConstPointView y, uint i, uint j ) const
+    {
+        return m_metrics.GetDistance( x, y, i, j );
+    }
+
+    bool WithinDistance( ConstPointView x, ConstPointView y, uint i, uint j, double threshold ) const
+    {
+        return m_metrics.WithinDistance( x, y, i, j, threshold );
+    }
+
+    void GetDistances( ConstPointView x, uint i, const uint *indices, uint count, double *outDistances ) const
+    {
+        m_metrics.GetDistances( x, i, m_points, indices, count, outDistances );
+    }
+
+    void GetWithinDistance( ConstPointView x, uint i, const uint *indices, uint count, double threshold, uint32_t *outMask ) const
+    {
+        m_metrics.GetWithinDistance( x, i, m_points, indices, count, threshold, outMask );
+    }
+
+private:
+
+    const PointCloud &m_points;
+    const Metrics &m_metrics;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Loads a point stored as Scalar, integral scalars are the fixed point coordinates of quantized clouds.
+template <uint DIM, class Scalar, bool QUANTIZED = std::is_integral<Scalar>::value>
+struct FixedPointLoader
+{
+    static FixedPoint<DIM> Load( const PointCloud &points, uint index )
+    {
+        return FixedPoint<DIM>( points.GetCoords<Scalar>( index ) );
+    }
+};
+
+
+template <uint DIM, class Scalar>
+struct FixedPointLoader<DIM, Scalar, true>
+{
+    static FixedPoint<DIM> Load( const PointCloud &points, uint index )
+    {
+        return FixedPoint<DIM>( points.GetCoords<Scalar>( index ), points.GetBoundsMin(), points.GetQuantizationSteps() );
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Scalar is the storage type of the cloud, coordinates are converted to double when loaded.
+template <class M, uint DIM, class Scalar>
+class FixedDistance
+{
+public:
+
+    typedef FixedPoint<DIM> PointType;
+
+    explicit FixedDistance( const PointCloud &points )
+        : m_points( points )
+    {
+        assert( points.GetDimension() == DIM );
+    }
+
+    PointType Load( uint index ) const
+    {
+        return FixedPointLoader<DIM, Scalar>::Load( m_points, index );
+    }
+
+    double GetDistance( const PointType &x, const PointType &y, uint, uint ) const
+    {
+        return M::template GetFixedDistance<DIM>( x, y );
+    }
+
+    bool WithinDistance( const PointType &x, const PointType &y, uint, uint, double threshold ) const
+    {
+        return M::template IsWithinFixedDistance<DIM>( x, y, threshold );
+    }
+
+    // Double precision coordinates are read in place by the SIMD kernels, if there are any.
+    void GetDistances( const PointType &x, uint, const uint *indices, uint count, double *outDistances ) const
+    {
+        if ( std::is_same<Scalar, double>::value && count > 0
+             && SimdDistance::GetDistances( M::TYPE, x.GetData(), m_points.GetCoords<double>( 0 ), DIM, indices, count, outDistances ) )
+        {
+            return;
+        }
+        for ( uint k = 0; k < count; ++k )
+        {
+            outDistances[k] = M::template GetFixedDistance<DIM>( x, Load( indices[k] ) );
+        }
+    }
+
+    // Vectorized distances are cheaper than the early exits of the scalar predicates.
+    void GetWithinDistance( const PointType &x, uint i, const uint *indices, uint count, double threshold, uint32_t *outMask ) const
+    {
+        if ( std::is_same<Scalar, double>::value && SimdDistance::Get() != SimdDistance::InstructionSet::Scalar )
+        {
+            double distances[Metrics::BATCH_SIZE];
+            for ( uint first = 0; first < count; first += Metrics::BATCH_SIZE )
+            {
+                const uint blockCount = std::min( count - first, static_cast<uint>( Metrics::BATCH_SIZE ) );
+                GetDistances( x, i, indices + first, blockCount, distances );
+                Metrics::GetWithinMask( distances, blockCount, threshold, outMask + first / 32 );
+            }
+            return;
+        }
+        std::fill_n( outMask, ( count + 31 ) / 32, 0 );
+        for ( uint k = 0; k < count; ++k )
+        {
+            if ( M::template IsWithinFixedDistance<DIM>( x, Load( indices[k] ), threshold ) )
+            {
+                outMask[k / 32] |= 1u << ( k % 32 );
+            }
+        }
+    }
+
+private:
+
+    const PointCloud &m_points;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Distance of graph points read in place from the domain and range clouds.
+class GenericGraphDistance
+{
+public:
+
+    struct PointType
+    {
+        Point m_domain;
+        Point m_range;
+    };
+
+    GenericGraphDistance( const GraphPointCloud &points, const Metrics &metrics )
+        : m_points( points )
+        , m_metrics( metrics )
+    {}
+
+    PointType Load( uint index ) const
+    {
+        PointType p{ Point( m_points.GetDomainDimension() ), Point( m_points.GetRangeDimension() ) };
+        m_points.GetDomainPoints().GetValue( index, p.m_domain );
+        m_points.GetRangePoints().GetValue( index, p.m_range );
+        return p;
+    }
+
+    double GetDistance( const PointType &x, const PointType &y, uint i, uint j ) const
+    {
+        return m_metrics.GetGraphDistance( x.m_domain, x.m_range, y.m_domain, y.m_range, i, j );
+    }
+
+    void GetDistances( const PointType &x, uint i, const uint *indices, uint count, double *outDistances ) const
+    {
+        m_metrics.GetGraphDistances( x.m_domain, x.m_range, i, m_points, indices, count, outDistances );
+    }
+
+    bool WithinDistance( const PointType &x, const PointType &y, uint i, uint j, double threshold ) const
+    {
+        return m_metrics.WithinGraphDistance( x.m_domain, x.m_range, y.m_domain, y.m_range, i, j, threshold );
+    }
+
+    void GetWithinDistance( const PointType &x, uint i, const uint *indices, uint count, double threshold, uint32_t *outMask ) const
+    {
+        m_metrics.GetGraphWithinDistance( x.m_domain, x.m_range, i, m_points, indices, count, threshold, outMask );
+    }
+
+private:
+
+    const GraphPointCloud &m_points;
+    const Metrics &m_metrics;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// MaxDomainRangeMetrics of the graph points with the domain and range metrics known at compile time.
+template <class DomainMetrics, class RangeMetrics, uint DOMAIN_DIM, uint RANGE_DIM, class Scalar>
+class FixedGraphDistance
+{
+public:
+
+    struct PointType
+    {
+        FixedPoint<DOMAIN_DIM> m_domain;
+        FixedPoint<RANGE_DIM> m_range;
+    };
+
+    explicit FixedGraphDistance( const GraphPointCloud &points )
+        : m_points( points )
+    {
+        assert( points.GetDomainDimension() == DOMAIN_DIM && points.GetRangeDimension() == RANGE_DIM );
+    }
+
+    PointType Load( uint index ) const
+    {
+        return PointType{ FixedPointLoader<DOMAIN_DIM, Scalar>::Load( m_points.GetDomainPoints(), index ),
+                          FixedPointLoader<RANGE_DIM, Scalar>::Load( m_points.GetRangePoints(), index ) };
+    }
+
+    double GetDistance( const PointType &x, const PointType &y, uint, uint ) const
+    {
+        return MaxDomainRangeMetrics::GetFixedDistance<DomainMetrics, RangeMetrics, DOMAIN_DIM, RANGE_DIM>( x.m_domain, x.m_range, y.m_domain, y.m_range );
+    }
+
+    void GetDistances( const PointType &x, uint, const uint *indices, uint count, double *outDistances ) const
+    {
+        for ( uint k = 0; k < count; ++k )
+        {
+            const PointType y = Load( indices[k] );
+            outDistances[k] = MaxDomainRangeMetrics::GetFixedDistance<DomainMetrics, RangeMetrics, DOMAIN_DIM, RANGE_DIM>( x.m_domain, x.m_range, y.m_domain, y.m_range );
+        }
+    }
+
+    bool WithinDistance( const PointType &x, const PointType &y, uint, uint, double threshold ) const
+    {
+        return MaxDomainRangeMetrics::IsWithinFixedDistance<DomainMetrics, RangeMetrics, DOMAIN_DIM, RANGE_DIM>( x.m_domain, x.m_range, y.m_domain, y.m_range, threshold );
+    }
+
+    void GetWithinDistance( const PointType &x, uint i, const uint *indices, uint count, double threshold, uint32_t *outMask ) const
+    {
+        std::fill_n( outMask, ( count + 31 ) / 32, 0 );
+        for ( uint k = 0; k < count; ++k )
+        {
+            if ( WithinDistance( x, Load( indices[k] ), i, indices[k], threshold ) )
+            {
+                outMask[k / 32] |= 1u << ( k % 32 );
+            }
+        }
+    }
+
+private:
+
+    const GraphPointCloud &m_points;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace FixedDistanceDispatch
+{
+
+template <class M, class Scalar, class Visitor>
+bool DispatchDimension( const PointCloud &points, Visitor &visitor )
+{
+    switch ( points.GetDimension() )
+    {
+    case 1: visitor.Visit( FixedDistance<M, 1, Scalar>( points ) ); return true;
+    case 2: visitor.Visit( FixedDistance<M, 2, Scalar>( points ) ); return true;
+    case 3: visitor.Visit( FixedDistance<M, 3, Scalar>( points ) ); return true;
+    case 4: visitor.Visit( FixedDistance<M, 4, Scalar>( points ) ); return true;
+    default: return false;
+    }
+}
+
+
+template <class M, class Visitor>
+bool DispatchDimension( const PointCloud &points, Visitor &visitor )
+{
+    switch ( points.GetPrecision() )
+    {
+    case PointCloud::Precision::Single: return DispatchDimension<M, float>( points, visitor );
+    case PointCloud::Precision::Fixed16: return DispatchDimension<M, uint16_t>( points, visitor );
+    case PointCloud::Precision::Fixed32: return DispatchDimension<M, uint32_t>( points, visitor );
+    default: return DispatchDimension<M, double>( points, visitor );
+    }
+}
+
+
+// Domain and range dimensions of all the test configurations are 1 or 2.
+template <class M, class Scalar, class Visitor>
+bool DispatchGraphDimensions( const GraphPointCloud &points, Visitor &visitor )
+{
+    const uint domainDim = points.GetDomainDimension();
+    const uint rangeDim = points.GetRangeDimension();
+    if ( domainDim == 1 && rangeDim == 1 )
+    {
+        visitor.Visit( FixedGraphDistance<M, M, 1, 1, Scalar>( points ) );
+    }
+    else if ( domainDim == 1 && rangeDim == 2 )
+    {
+        visitor.Visit( FixedGraphDistance<M, M, 1, 2, Scalar>( points ) );
+    }
+    else if ( domainDim == 2 && rangeDim == 1 )
+    {
+        visitor.Visit( FixedGraphDistance<M, M, 2, 1, Scalar>( points ) );
+    }
+    else if ( domainDim == 2 && rangeDim == 2 )
+    {
+        visitor.Visit( FixedGraphDistance<M, M, 2, 2, Scalar>( points ) );
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+
+// Both clouds of a graph have the same precision unless they were created with different defaults.
+template <class M, class Visitor>
+bool DispatchGraphDimensions( const GraphPointCloud &points, Visitor &visitor )
+{
+    const PointCloud::Precision precision = points.GetDomainPoints().GetPrecision();
+    if ( points.GetRangePoints().GetPrecision() != precision )
+    {
+        return false;
+    }
+    switch ( precision )
+    {
+    case PointCloud::Precision::Single: return DispatchGraphDimensions<M, float>( points, visitor );
+    case PointCloud::Precision::Fixed16: return DispatchGraphDimensions<M, uint16_t>( points, visitor );
+    case PointCloud::Precision::Fixed32: return DispatchGraphDimensions<M, uint32_t>( points, visitor );
+    default: return DispatchGraphDimensions<M, double>( points, visitor );
+    }
+}
+
+} // namespace FixedDistanceDispatch
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Calls visitor.Visit( distance ) with the fixed dimension distance for the metrics and the dimension
+// of the points. Returns false without calling the visitor if there is no such specialization.
+template <class Visitor>
+bool DispatchFixedDistance( const PointCloud &points, const Metrics &metrics, Visitor &visitor )
+{
+    using namespace FixedDistanceDispatch;
+    switch ( metrics.GetType() )
+    {
+    case Metrics::Type::Euclidean: return DispatchDimension<EuclideanMetrics>( points, visitor );
+    case Metrics::Type::Max: return DispatchDimension<MaxMetrics>( points, visitor );
+    case Metrics::Type::Taxi: return DispatchDimension<TaxiMetrics>( points, visitor );
+    default: return false;
+    }
+}
+
+
+// Graph counterpart of DispatchFixedDistance. Only the graph metrics built of two metrics of the same
+// type are specialized, which is what MetricsProxy creates.
+template <class Visitor>
+bool DispatchFixedDistance( const GraphPointCloud &points, const Metrics &metrics, Visitor &visitor )
+{
+    using namespace FixedDistanceDispatch;
+    if ( metrics.GetType() != Metrics::Type::MaxDomainRange )
+    {
+        return false;
+    }
+    const MaxDomainRangeMetrics &graphMetrics = static_cast<const MaxDomainRangeMetrics &>( metrics );
+    const Metrics::Type type = graphMetrics.GetDomainMetrics().GetType();
+    if ( graphMetrics.GetRangeMetrics().GetType() != type
+         || graphMetrics.GetDomainDimension() != points.GetDomainDimension() || graphMetrics.GetRangeDimension() != points.GetRangeDimension() )
+    {
+        return false;
+    }
+    switch ( type )
+    {
+    case Metrics::Type::Euclidean: return DispatchGraphDimensions<EuclideanMetrics>( points, visitor );
+    case Metrics::Type::Max: return DispatchGraphDimensions<MaxMetrics>( points, visitor );
+    case Metrics::Type::Taxi: return DispatchGraphDimensions<TaxiMetrics>( points, visitor );
+    default: return false;
+    }
+}
+
+
+// Calls visitor.Visit( distance ) with the fastest distance available, falling back to GenericDistance.
+template <class Visitor>
+void DispatchDistance( const PointCloud &points, const Metrics &metrics, Visitor &visitor )
+{
+#if FIXED_DIMENSION_KERNELS
+    if ( DispatchFixedDistance( points, metrics, visitor ) )
+    {
+        return;
+    }
+#endif
+    visitor.Visit( GenericDistance( points, metrics ) );
+}
+
+
+template <class Visitor>
+void DispatchDistance( const GraphPointCloud &points, const Metrics &metrics, Visitor &visitor )
+{
+#if FIXED_DIMENSION_KERNELS
+    if ( DispatchFixedDistance( points, metrics, visitor ) )
+    {
+        return;
+    }
+#endif
+    visitor.Visit( GenericGraphDistance( points, metrics ) );
+}
@@ -0,0 +1,88 @@
+// pbrendel (c) 2021
+
+#pragma once
+
+#include "point.h"
+#include "Core/assert.h"
+
+
+// Point of a dimension known at compile time. Coordinates are kept by value, so loops over them
+// are unrolled by the compiler and the point lives in registers in the distance kernels.
+template <uint DIM>
+class FixedPoint
+{
+public:
+
+	enum : uint
+	{
+		DIMENSION = DIM,
+	};
+
+	FixedPoint()
+	{}
+
+	// Coordinates stored as floats are widened to double.
+	template <class T>
+	explicit FixedPoint( const T *data )
+	{
+		for ( uint i = 0; i < DIM; ++i )
+		{
+			m_data[i] = data[i];
+		}
+	}
+
+	// Fixed point coordinates restored within the bounds of a quantized cloud.
+	template <class T>
+	FixedPoint( const T *data, const double *boundsMin, const double *steps )
+	{
+		for ( uint i = 0; i < DIM; ++i )
+		{
+			m_data[i] = boundsMin[i] + data[i] * steps[i];
+		}
+	}
+
+	explicit FixedPoint( ConstPointView p )
+		: FixedPoint( static_cast<const double *>( p.Begin() ) )
+	{
+		assert( p.GetDimension() == DIM );
+	}
+
+	constexpr uint GetDimension() const
+	{
+		return DIM;
+	}
+
+	double &operator[]( uint index )
+	{
+		assert( index < DIM );
+		return m_data[index];
+	}
+
+	double operator[]( uint index ) const
+	{
+		assert( index < DIM );
+		return m_data[index];
+	}
+
+	const double *GetData() const
+	{
+		return m_data;
+	}
+
+	// Coordinates OFFSET..OFFSET+SUB_DIM, e.g. the domain or the range part of a graph point.
+	template <uint OFFSET, uint SUB_DIM>
+	FixedPoint<SUB_DIM> GetSlice() const
+	{
+		static_assert( OFFSET + SUB_DIM <= DIM, "Slice out of range" );
+		return FixedPoint<SUB_DIM>( m_data + OFFSET );
+	}
+
+private:
+
+	double m_data[DIM];
+};
+
+typedef FixedPoint<1> Point1;
+typedef FixedPoint<2> Point2;
+typedef FixedPoint<3> Point3;
+typedef FixedPoint<4> Point4;
@@ -0,0 +1,227 @@
+// pbrendel (c) 2021
+
+#include "hardwareCounters.h"
+#include "Core/defs.h"
+
+#include <cstring>
+#include <iomanip>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+HardwareCounters &HardwareCounters::Get()
+{
+    static HardwareCounters s_instance;
+    return s_instance;
+}
+
+
+HardwareCounters::HardwareCounters()
+    : m_openedCount( 0 )
+    , m_enabled( false )
+{
+    for ( uint i = 0; i < COUNTERS_COUNT; ++i )
+    {
+        m_fds[i] = -1;
+        m_readIndices[i] = O_INVALID_INDEX;
+    }
+}
+
+
+HardwareCounters::~HardwareCounters()
+{
+    Disable();
+}
+
+#ifdef __linux__
+
+static int OpenCounter( uint32_t type, uint64_t config, int groupFd )
+{
+    perf_event_attr attr;
+    memset( &attr, 0, sizeof( attr ) );
+    attr.size = sizeof( attr );
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = groupFd == -1 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>( syscall( __NR_perf_event_open, &attr, 0, -1, groupFd, 0 ) );
+}
+
+
+bool HardwareCounters::Enable()
+{
+    if ( m_enabled )
+    {
+        return true;
+    }
+    const uint32_t types[COUNTERS_COUNT] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE };
+    const uint64_t configs[COUNTERS_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_L1D | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 ),
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES,
+    };
+    // Cycles lead the group, the other counters are optional as not every CPU supports all of them.
+    m_fds[Cycles] = OpenCounter( types[Cycles], configs[Cycles], -1 );
+    if ( m_fds[Cycles] == -1 )
+    {
+        return false;
+    }
+    m_readIndices[Cycles] = 0;
+    m_openedCount = 1;
+    for ( uint i = Cycles + 1; i < COUNTERS_COUNT; ++i )
+    {
+        m_fds[i] = OpenCounter( types[i], configs[i], m_fds[Cycles] );
+        if ( m_fds[i] != -1 )
+        {
+            m_readIndices[i] = m_openedCount++;
+        }
+    }
+    ioctl( m_fds[Cycles], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP );
+    ioctl( m_fds[Cycles], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+    m_enabled = true;
+    return true;
+}
+
+
+void HardwareCounters::Disable()
+{
+    for ( uint i = 0; i < COUNTERS_COUNT; ++i )
+    {
+        if ( m_fds[i] != -1 )
+        {
+            close( m_fds[i] );
+            m_fds[i] = -1;
+        }
+        m_readIndices[i] = O_INVALID_INDEX;
+    }
+    m_openedCount = 0;
+    m_enabled = false;
+}
+
+
+void HardwareCounters::Read( uint64_t *outValues ) const
+{
+    // Group read format: number of counters, time enabled, time running, then the counter values.
+    uint64_t buffer[COUNTERS_COUNT + 3] = { 0 };
+    if ( read( m_fds[Cycles], buffer, sizeof( buffer ) ) <= 0 )
+    {
+        memset( buffer, 0, sizeof( buffer ) );
+    }
+    for ( uint i = 0; i < COUNTERS_COUNT; ++i )
+    {
+        outValues[i] = m_readIndices[i] != O_INVALID_INDEX ? buffer[3 + m_readIndices[i]] : 0;
+    }
+    outValues[TimeEnabled] = buffer[1];
+    outValues[TimeRunning] = buffer[2];
+}
+
+#else
+
+bool HardwareCounters::Enable()
+{
+    return false;
+}
+
+
+void HardwareCounters::Disable()
+{
+    m_enabled = false;
+}
+
+
+void HardwareCounters::Read( uint64_t *outValues ) const
+{
+    memset( outValues, 0, VALUES_COUNT * sizeof( uint64_t ) );
+}
+
+#endif
+
+
+void HardwareCounters::Add( const char *name, uint64_t items, const uint64_t *begin, const uint64_t *end )
+{
+    Entry *entry = nullptr;
+    for ( o::DynArray<Entry>::Iterator it = m_entries.Begin(); it != m_entries.End(); ++it )
+    {
+        if ( it->m_name == name || strcmp( it->m_name, name ) == 0 )
+        {
+            entry = &*it;
+            break;
+        }
+    }
+    if ( entry == nullptr )
+    {
+        Entry newEntry;
+        memset( &newEntry, 0, sizeof( newEntry ) );
+        newEntry.m_name = name;
+        m_entries.PushBack( newEntry );
+        entry = &m_entries.Back();
+    }
+    entry->m_calls++;
+    entry->m_items += items;
+    // Multiplexed counters only see a part of the scope, their counts are extrapolated to the whole of it.
+    const uint64_t timeEnabled = end[TimeEnabled] - begin[TimeEnabled];
+    const uint64_t timeRunning = end[TimeRunning] - begin[TimeRunning];
+    const double scale = timeRunning > 0 && timeRunning < timeEnabled ? static_cast<double>( timeEnabled ) / timeRunning : 1.0;
+    for ( uint i = 0; i < COUNTERS_COUNT; ++i )
+    {
+        entry->m_values[i] += static_cast<uint64_t>( ( end[i] - begin[i] ) * scale + 0.5 );
+    }
+    entry->m_timeEnabled += timeEnabled;
+    entry->m_timeRunning += timeRunning;
+}
+
+
+void HardwareCounters::Reset()
+{
+    m_entries.Clear();
+}
+
+
+void HardwareCounters::Print( std::ostream &str ) const
+{
+    if ( !m_enabled )
+    {
+        return;
+    }
+    const char *names[COUNTERS_COUNT] = { "cycles/pt", "instr/pt", "L1D miss/pt", "LLC miss/pt", "br miss/pt" };
+    str << std::left << std::setw( 44 ) << "hardware counters" << std::right
+        << std::setw( 10 ) << "calls"
+        << std::setw( 14 ) << "points"
+        << std::setw( 8 ) << "IPC"
+        << std::setw( 8 ) << "run %";
+    for ( uint i = 0; i < COUNTERS_COUNT; ++i )
+    {
+        str << std::setw( 14 ) << ( m_readIndices[i] != O_INVALID_INDEX ? names[i] : "n/a" );
+    }
+    str << std::endl;
+    const std::streamsize precision = str.precision();
+    for ( o::DynArray<Entry>::ConstIterator it = m_entries.Begin(); it != m_entries.End(); ++it )
+    {
+        const double items = it->m_items > 0 ? static_cast<double>( it->m_items ) : 1.0;
+        const double ipc = it->m_values[Cycles] > 0 ? static_cast<double>( it->m_values[Instructions] ) / it->m_values[Cycles] : 0.0;
+        // Below 100 the counts are scaled up from the time the group was on the PMU, so they are estimates.
+        const double running = it->m_timeEnabled > 0 ? 100.0 * it->m_timeRunning / it->m_timeEnabled : 100.0;
+        str << std::left << std::setw( 44 ) << it->m_name << std::right
+            << std::setw( 10 ) << it->m_calls
+            << std::setw( 14 ) << it->m_items
+            << std::fixed << std::setprecision( 2 )
+            << std::setw( 8 ) << ipc
+            << std::setw( 8 ) << running;
+        for ( uint i = 0; i < COUNTERS_COUNT; ++i )
+        {
+            str << std::setw( 14 ) << it->m_values[i] / items;
+        }
+        str << std::endl;
+        str.unsetf( std::ios_base::floatfield );
+        str.precision( precision );
+    }
+}
@@ -0,0 +1,111 @@
+// pbrendel (c) 2021
+
+#pragma once
+
+#include "Core/dynArray.h"
+
+#include <cstdint>
+#include <ostream>
+
+
+// CPU performance counters read with perf_event_open, available on Linux only. Counters are
+// accumulated per phase name together with the number of points processed in the phase.
+class HardwareCounters
+{
+public:
+
+    enum Counter : uint
+    {
+        Cycles,
+        Instructions,
+        L1DMisses,
+        LLCMisses,
+        BranchMisses,
+        COUNTERS_COUNT,
+        // Times the group was enabled and actually counting, running is shorter when the PMU
+        // multiplexes the counters with other events. Read returns them after the counters.
+        TimeEnabled = COUNTERS_COUNT,
+        TimeRunning,
+        VALUES_COUNT,
+    };
+
+    static HardwareCounters &Get();
+
+    // Returns false if the counters cannot be opened, e.g. because of perf_event_paranoid.
+    bool Enable();
+    void Disable();
+
+    bool IsEnabled() const
+    {
+        return m_enabled;
+    }
+
+    void Read( uint64_t *outValues ) const;
+    void Add( const char *name, uint64_t items, const uint64_t *begin, const uint64_t *end );
+    void Reset();
+    void Print( std::ostream &str ) const;
+
+private:
+
+    struct Entry
+    {
+        const char *m_name;
+        uint64_t m_calls;
+        uint64_t m_items;
+        uint64_t m_values[COUNTERS_COUNT];
+        uint64_t m_timeEnabled;
+        uint64_t m_timeRunning;
+    };
+
+    HardwareCounters();
+    ~HardwareCounters();
+
+    int m_fds[COUNTERS_COUNT];
+    // Position of each counter in the group read buffer, O_INVALID_INDEX if it is not available.
+    uint m_readIndices[COUNTERS_COUNT];
+    uint m_openedCount;
+    bool m_enabled;
+    o::DynArray<Entry> m_entries;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class HardwareCounterScope
+{
+public:
+
+    // Name has to outlive the counters entry, string literals are expected here.
+    HardwareCounterScope( const char *name )
+        : m_name( name )
+        , m_items( 0 )
+        , m_enabled( HardwareCounters::Get().IsEnabled() )
+    {
+        if ( m_enabled )
+        {
+            HardwareCounters::Get().Read( m_begin );
+        }
+    }
+
+    ~HardwareCounterScope()
+    {
+        if ( m_enabled )
+        {
+            uint64_t end[HardwareCounters::VALUES_COUNT];
+            HardwareCounters::Get().Read( end );
+            HardwareCounters::Get().Add( m_name, m_items, m_begin, end );
+        }
+    }
+
+    // Number of points processed, used for the per point figures.
+    void SetItems( uint64_t items )
+    {
+        m_items = items;
+    }
+
+private:
+
+    const char *m_name;
+    uint64_t m_items;
+    uint64_t m_begin[HardwareCounters::VALUES_COUNT];
+    bool m_enabled;
+};
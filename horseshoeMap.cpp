@@ -37,7 +37,7 @@ HorseshoeExitSetQuotientMetrics::HorseshoeExitSetQuotientMetrics( const Interval
 }
 
 
-double HorseshoeExitSetQuotientMetrics::GetDistance( const Point &x, const Point &y, uint, uint ) const
+double HorseshoeExitSetQuotientMetrics::GetDistance( ConstPointView x, ConstPointView y, uint, uint ) const
 {
     if ( m_isTrivial )
     {
@@ -92,13 +92,13 @@ void HorseshoeExitSetQuotientMetrics::SetXExitSet( uint index, double progress,
 }
 
 
-bool HorseshoeExitSetQuotientMetrics::IsInExitSet( const Point &p ) const
+bool HorseshoeExitSetQuotientMetrics::IsInExitSet( ConstPointView p ) const
 {
     return m_isTrivial ? true : IsInExitSet( p, GetPieceIndex( p[1] ) );
 }
 
 
-double HorseshoeExitSetQuotientMetrics::GetDistanceToExitSet( const Point &p ) const
+double HorseshoeExitSetQuotientMetrics::GetDistanceToExitSet( ConstPointView p ) const
 {
     return m_isTrivial ? 0.0 : GetDistanceToExitSet( p, GetPieceIndex( p[1] ) );
 }
@@ -162,7 +162,7 @@ bool HorseshoeExitSetQuotientMetrics::IsExitSetIndex( uint pieceIndex ) const
 }
 
 
-bool HorseshoeExitSetQuotientMetrics::IsInExitSet( const Point &p, uint pieceIndex ) const
+bool HorseshoeExitSetQuotientMetrics::IsInExitSet( ConstPointView p, uint pieceIndex ) const
 {
     if ( m_isTrivial )
     {
@@ -176,7 +176,7 @@ bool HorseshoeExitSetQuotientMetrics::IsInExitSet( const Point &p, uint pieceInd
 }
 
 
-double HorseshoeExitSetQuotientMetrics::GetDistanceToExitSet( const Point &p, uint pieceIndex ) const
+double HorseshoeExitSetQuotientMetrics::GetDistanceToExitSet( ConstPointView p, uint pieceIndex ) const
 {
     if ( m_isTrivial )
     {
@@ -18,13 +18,13 @@ public:
 
     HorseshoeExitSetQuotientMetrics( const Interval &yInterval, double exitMargin, uint piecesCount );
 
-    virtual double GetDistance( const Point &x, const Point &y, uint, uint ) const override;
+    virtual double GetDistance( ConstPointView x, ConstPointView y, uint, uint ) const override;
  
     void AddPieceToExitSet( uint pieceIndex );
     void RemovePieceFromExitSet( uint pieceIndex );
     void SetXExitSet( uint index, double progress, bool isInvert, const Interval &xInterval );
-    bool IsInExitSet( const Point &p ) const;
-    double GetDistanceToExitSet( const Point &p ) const;
+    bool IsInExitSet( ConstPointView p ) const;
+    double GetDistanceToExitSet( ConstPointView p ) const;
 
     void SetIsTrivial( bool trivial )
     {
@@ -36,8 +36,8 @@ private:
     void UpdatePrevNextExitSet();
     uint GetPieceIndex( double y ) const;
     bool IsExitSetIndex( uint pieceIndex ) const;
-    bool IsInExitSet( const Point &p, uint pieceIndex ) const;
-    double GetDistanceToExitSet( const Point &p, uint pieceIndex ) const;
+    bool IsInExitSet( ConstPointView p, uint pieceIndex ) const;
+    double GetDistanceToExitSet( ConstPointView p, uint pieceIndex ) const;
 
     o::DynArray<double> m_thresholds;
     o::DynArray<uint> m_exitSetIndices;
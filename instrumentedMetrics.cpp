@@ -0,0 +1,207 @@
+// pbrendel (c) 2021
+
+#include "instrumentedMetrics.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+
+const double MetricsCounters::s_binBounds[HISTOGRAM_BINS] = { 0.5, 1.0, 2.0, 4.0, 8.0, 16.0, std::numeric_limits<double>::max() };
+
+
+MetricsCounters::MetricsCounters()
+    : m_calls( 0 )
+    , m_indexCalls( 0 )
+    , m_mixedCalls( 0 )
+    , m_pointCalls( 0 )
+{
+    std::fill_n( m_histogram, static_cast<uint>( HISTOGRAM_BINS ), 0 );
+}
+
+
+void MetricsCounters::Add( uint i, uint j, double distance, double threshold )
+{
+    m_calls++;
+    const uint indices = ( i != Metrics::NO_INDEX ? 1 : 0 ) + ( j != Metrics::NO_INDEX ? 1 : 0 );
+    if ( indices == 2 )
+    {
+        m_indexCalls++;
+    }
+    else if ( indices == 1 )
+    {
+        m_mixedCalls++;
+    }
+    else
+    {
+        m_pointCalls++;
+    }
+    const double ratio = threshold > 0.0 ? distance / threshold : std::numeric_limits<double>::max();
+    uint bin = 0;
+    while ( bin + 1 < HISTOGRAM_BINS && ratio > s_binBounds[bin] )
+    {
+        bin++;
+    }
+    m_histogram[bin]++;
+}
+
+
+void MetricsCounters::Add( const MetricsCounters &other )
+{
+    m_calls += other.m_calls;
+    m_indexCalls += other.m_indexCalls;
+    m_mixedCalls += other.m_mixedCalls;
+    m_pointCalls += other.m_pointCalls;
+    for ( uint i = 0; i < HISTOGRAM_BINS; ++i )
+    {
+        m_histogram[i] += other.m_histogram[i];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+MetricsStatistics &MetricsStatistics::Get()
+{
+    static MetricsStatistics s_instance;
+    return s_instance;
+}
+
+
+MetricsCounters &MetricsStatistics::GetCounters( uint phase )
+{
+    if ( phase >= m_counters.GetSize() )
+    {
+        m_counters.Resize( phase + 1 );
+    }
+    return m_counters[phase];
+}
+
+
+void MetricsStatistics::Reset()
+{
+    m_counters.Clear();
+}
+
+
+void MetricsStatistics::Print( std::ostream &str ) const
+{
+    MetricsCounters total;
+    for ( o::DynArray<MetricsCounters>::ConstIterator it = m_counters.Begin(); it != m_counters.End(); ++it )
+    {
+        total.Add( *it );
+    }
+    if ( total.m_calls == 0 )
+    {
+        return;
+    }
+    const std::streamsize precision = str.precision();
+    str << "distance evaluations (histogram of distance / threshold):" << std::endl;
+    str << std::setw( 14 ) << "calls"
+        << std::setw( 8 ) << "index%"
+        << std::setw( 8 ) << "mixed%"
+        << std::setw( 8 ) << "point%";
+    for ( uint i = 0; i < MetricsCounters::HISTOGRAM_BINS; ++i )
+    {
+        std::ostringstream bin;
+        if ( i + 1 < MetricsCounters::HISTOGRAM_BINS )
+        {
+            bin << "<=" << MetricsCounters::s_binBounds[i];
+        }
+        else
+        {
+            bin << ">" << MetricsCounters::s_binBounds[i - 1];
+        }
+        str << std::setw( 8 ) << bin.str();
+    }
+    str << "  phase" << std::endl;
+    const uint phasesCount = m_counters.GetSize();
+    for ( uint phase = 0; phase < phasesCount; ++phase )
+    {
+        const MetricsCounters &counters = m_counters[phase];
+        if ( counters.m_calls == 0 )
+        {
+            continue;
+        }
+        const double toPercent = 100.0 / counters.m_calls;
+        str << std::setw( 14 ) << counters.m_calls
+            << std::fixed << std::setprecision( 1 )
+            << std::setw( 8 ) << counters.m_indexCalls * toPercent
+            << std::setw( 8 ) << counters.m_mixedCalls * toPercent
+            << std::setw( 8 ) << counters.m_pointCalls * toPercent;
+        for ( uint i = 0; i < MetricsCounters::HISTOGRAM_BINS; ++i )
+        {
+            str << std::setw( 8 ) << counters.m_histogram[i] * toPercent;
+        }
+        str << "  " << Profiler::Get().GetPath( phase ) << std::endl;
+        str.unsetf( std::ios_base::floatfield );
+    }
+    str.precision( precision );
+    str << "total calls: " << total.m_calls << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+template <class Base>
+double Instrumented<Base>::GetDistance( ConstPointView x, ConstPointView y, uint i, uint j ) const
+{
+    const double distance = m_metrics.GetDistance( x, y, i, j );
+    Add( i, j, distance );
+    return distance;
+}
+
+
+template <class Base>
+double Instrumented<Base>::GetGraphDistance( ConstPointView xDomain, ConstPointView xRange, ConstPointView yDomain, ConstPointView yRange, uint i, uint j ) const
+{
+    const double distance = m_metrics.GetGraphDistance( xDomain, xRange, yDomain, yRange, i, j );
+    Add( i, j, distance );
+    return distance;
+}
+
+
+// Batches are counted as the single calls they replace.
+template <class Base>
+void Instrumented<Base>::GetDistances( ConstPointView x, uint i, const PointCloud &points, const uint *indices, uint count, double *outDistances ) const
+{
+    m_metrics.GetDistances( x, i, points, indices, count, outDistances );
+    AddBatch( i, indices, count, outDistances );
+}
+
+
+template <class Base>
+void Instrumented<Base>::GetGraphDistances( ConstPointView xDomain, ConstPointView xRange, uint i, const GraphPointCloud &points, const uint *indices, uint count, double *outDistances ) const
+{
+    m_metrics.GetGraphDistances( xDomain, xRange, i, points, indices, count, outDistances );
+    AddBatch( i, indices, count, outDistances );
+}
+
+
+template <class Base>
+void Instrumented<Base>::Add( uint i, uint j, double distance ) const
+{
+    if ( !MetricsStatistics::Get().IsSuspended() )
+    {
+        MetricsStatistics::Get().GetCounters( Profiler::Get().GetCurrent() ).Add( i, j, distance, m_threshold );
+    }
+}
+
+
+template <class Base>
+void Instrumented<Base>::AddBatch( uint i, const uint *indices, uint count, const double *distances ) const
+{
+    if ( MetricsStatistics::Get().IsSuspended() )
+    {
+        return;
+    }
+    MetricsCounters &counters = MetricsStatistics::Get().GetCounters( Profiler::Get().GetCurrent() );
+    for ( uint k = 0; k < count; ++k )
+    {
+        counters.Add( i, indices[k], distances[k], m_threshold );
+    }
+}
+
+
+template class Instrumented<Metrics>;
+template class Instrumented<IndexMetrics>;
@@ -0,0 +1,172 @@
+// pbrendel (c) 2021
+
+#pragma once
+
+#include "metrics.h"
+#include "Core/assert.h"
+
+#include <cstdint>
+#include <ostream>
+
+// Set to 1 to count distance evaluations made by the computations, see MetricsProbe.
+#ifndef METRICS_INSTRUMENTATION
+#define METRICS_INSTRUMENTATION 0
+#endif
+
+
+struct MetricsCounters
+{
+    enum : uint
+    {
+        HISTOGRAM_BINS = 7,
+    };
+
+    // Upper bounds of the histogram bins, as a multiple of the threshold.
+    static const double s_binBounds[HISTOGRAM_BINS];
+
+    uint64_t m_calls;
+    uint64_t m_indexCalls;
+    uint64_t m_mixedCalls;
+    uint64_t m_pointCalls;
+    uint64_t m_histogram[HISTOGRAM_BINS];
+
+    MetricsCounters();
+
+    void Add( uint i, uint j, double distance, double threshold );
+    void Add( const MetricsCounters &other );
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Counters of distance evaluations per profiler phase.
+class MetricsStatistics
+{
+public:
+
+    static MetricsStatistics &Get();
+
+    MetricsCounters &GetCounters( uint phase );
+    void Reset();
+    void Print( std::ostream &str ) const;
+
+    // Evaluations made while suspended are not counted, e.g. the debug checks of the results.
+    void Suspend()
+    {
+        m_suspendCount++;
+    }
+
+    void Resume()
+    {
+        assert( m_suspendCount > 0 );
+        m_suspendCount--;
+    }
+
+    bool IsSuspended() const
+    {
+        return m_suspendCount > 0;
+    }
+
+private:
+
+    MetricsStatistics()
+        : m_suspendCount( 0 )
+    {}
+
+    o::DynArray<MetricsCounters> m_counters;
+    uint m_suspendCount;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class MetricsStatisticsSuspendScope
+{
+public:
+
+    MetricsStatisticsSuspendScope()
+    {
+        MetricsStatistics::Get().Suspend();
+    }
+
+    ~MetricsStatisticsSuspendScope()
+    {
+        MetricsStatistics::Get().Resume();
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Decorator counting the calls of the wrapped metrics in the current profiler phase.
+// Distances are put in the histogram relative to the threshold the caller compares them with.
+// Base is IndexMetrics for the index metrics, so the decorator is of the same kind as the metrics it wraps.
+template <class Base>
+class Instrumented : public Base
+{
+public:
+
+    Instrumented( const Metrics &metrics, double threshold )
+        : m_metrics( metrics )
+        , m_threshold( threshold )
+    {}
+
+    virtual double GetDistance( ConstPointView x, ConstPointView y, uint i, uint j ) const override;
+    virtual double GetGraphDistance( ConstPointView xDomain, ConstPointView xRange, ConstPointView yDomain, ConstPointView yRange, uint i, uint j ) const override;
+    virtual void GetDistances( ConstPointView x, uint i, const PointCloud &points, const uint *indices, uint count, double *outDistances ) const override;
+    virtual void GetGraphDistances( ConstPointView xDomain, ConstPointView xRange, uint i, const GraphPointCloud &points, const uint *indices, uint count, double *outDistances ) const override;
+
+    virtual bool HasIndexMetrics() const override { return m_metrics.HasIndexMetrics(); }
+    virtual bool RequiresDoublePrecision() const override { return m_metrics.RequiresDoublePrecision(); }
+    virtual o::Ptr<IndexMetrics> CreateIndexMetrics( const PointCloud &points ) const override { return m_metrics.CreateIndexMetrics( points ); }
+
+private:
+
+    void Add( uint i, uint j, double distance ) const;
+    void AddBatch( uint i, const uint *indices, uint count, const double *distances ) const;
+
+    const Metrics &m_metrics;
+    double m_threshold;
+};
+
+typedef Instrumented<Metrics> InstrumentedMetrics;
+typedef Instrumented<IndexMetrics> InstrumentedIndexMetrics;
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Passes the metrics through, or wraps them when METRICS_INSTRUMENTATION is set. Both decorators
+// are kept, Get returns the one of the same kind as the wrapped metrics.
+class MetricsProbe
+{
+public:
+
+#if METRICS_INSTRUMENTATION
+    MetricsProbe( const Metrics &metrics, double threshold )
+        : m_metrics( metrics, threshold )
+        , m_indexMetrics( metrics, threshold )
+        , m_isIndexMetrics( metrics.IsIndexMetrics() )
+    {}
+#else
+    MetricsProbe( const Metrics &metrics, double )
+        : m_metrics( metrics )
+    {}
+#endif
+
+    const Metrics &Get() const
+    {
+#if METRICS_INSTRUMENTATION
+        if ( m_isIndexMetrics )
+        {
+            return m_indexMetrics;
+        }
+#endif
+        return m_metrics;
+    }
+
+private:
+
+#if METRICS_INSTRUMENTATION
+    InstrumentedMetrics m_metrics;
+    InstrumentedIndexMetrics m_indexMetrics;
+    bool m_isIndexMetrics;
+#else
+    const Metrics &m_metrics;
+#endif
+};
@@ -1,83 +1,162 @@
 // pbrendel (c) 2013-21
 
 #include "localKernelsPersistence.h"
+#include "arena.h"
 #include "domain.h"
+#include "instrumentedMetrics.h"
 #include "map.h"
 #include "metrics.h"
+#include "profiler.h"
+#include "progress.h"
 #include "ripsComplex.h"
+#include "trace.h"
 #include "Core/dynArray.h"
+#include "Core/perfCounter.h"
+
+#include <algorithm>
 
 using o::DynArray;
 
 
+// Center coordinates let the trace viewer locate pathological neighbourhoods in the domain.
+static void AddTraceCenter( TraceScope &trace, uint index, const Point &center )
+{
+    static const char * const coordNames[] = { "x", "y" };
+    trace.AddArg( "index", index );
+    for ( uint i = 0; i < center.GetDimension() && i < 2; ++i )
+    {
+        trace.AddArg( coordNames[i], center[i] );
+    }
+}
+
+
+// Graph distances of the euclidean metrics are off by at most the larger of the domain and range bounds.
+static void UpdateQuantizationStatistics( const LocalKernelsPersistence::PointsProxy &points, LocalKernelsPersistence::Statistics &statistics )
+{
+    const PointCloud &domainPoints = points.m_domainPoints;
+    const PointCloud &rangePoints = points.m_rangePoints;
+    statistics.m_coordinateErrorBound = std::max( { statistics.m_coordinateErrorBound, domainPoints.GetCoordinateErrorBound(), rangePoints.GetCoordinateErrorBound() } );
+    statistics.m_euclideanErrorBound = std::max( { statistics.m_euclideanErrorBound, domainPoints.GetEuclideanErrorBound(), rangePoints.GetEuclideanErrorBound() } );
+    statistics.m_clampedCoordsCount = std::max( statistics.m_clampedCoordsCount, domainPoints.GetClampedCount() + rangePoints.GetClampedCount() );
+}
+
+
+// Values of the maps are not bounded in advance, so for quantized clouds the map is evaluated
+// once more to find the bounds. Maps with noise may still get some values clamped.
+static void FindRangeBounds( const PointCloud &domainPoints, const Map &map, Cube &outBounds )
+{
+    ProfileScope scope( "FindRangeBounds" );
+    const uint rangeDim = map.GetDimension();
+    outBounds.SetDimension( rangeDim );
+    Point d( domainPoints.GetDimension() );
+    Point r( rangeDim );
+    const uint count = domainPoints.GetSize();
+    for ( uint i = 0; i < count; ++i )
+    {
+        domainPoints.GetValue( i, d );
+        map.GetValue( d, r );
+        for ( uint d = 0; d < rangeDim; ++d )
+        {
+            Interval &interval = outBounds[d];
+            interval = i == 0 ? Interval( r[d], r[d] ) : Interval( std::min( interval.m_min, r[d] ), std::max( interval.m_max, r[d] ) );
+        }
+    }
+}
+
+
 void LocalKernelsPersistence::CreatePoints( const Domain &domain, const Map &map, uint pcfFlags, PointsProxy &outPoints )
 {
-    PointsList &domainPoints = outPoints.m_domainPoints;
-    PointsList &rangePoints = outPoints.m_rangePoints;
-    PointsList &graphPoints = outPoints.m_graphPoints;
-    domainPoints.Clear();
-    rangePoints.Clear();
-    graphPoints.Clear();
+    ProfileScope scope( "LocalKernelsPersistence::CreatePoints" );
+    PointCloud &domainPoints = outPoints.m_domainPoints;
+    PointCloud &rangePoints = outPoints.m_rangePoints;
     const bool createDomain = pcfFlags & PCF_Domain;
     const bool createRange = pcfFlags & PCF_Range;
     const bool createGraph = pcfFlags & PCF_Graph;
     const uint domainDim = domain.GetDimension();
     const uint rangeDim = map.GetDimension();
+    const uint count = domain.GetCount();
+    // Graph points are views of the domain and range points, so these are dropped at the end only if not needed.
+    domain.GetValues( domainPoints );
+    rangePoints.Reset( rangeDim, count );
+    if ( rangePoints.IsQuantized() )
+    {
+        Cube rangeBounds;
+        FindRangeBounds( domainPoints, map, rangeBounds );
+        rangePoints.SetBounds( rangeBounds );
+    }
+    // The map is evaluated at the stored domain coordinates.
     Point d( domainDim );
     Point r( rangeDim );
-    Point g( domainDim + rangeDim );
-    const uint count = domain.GetCount();
     for ( uint i = 0; i < count; ++i )
     {
-        domain.GetValue( i, d );
+        domainPoints.GetValue( i, d );
         map.GetValue( d, r );
-        if ( createDomain )
-        {
-            domainPoints.PushBack( d );
-        }
-        if ( createRange )
-        {
-            rangePoints.PushBack( r );
-        }
-        if ( createGraph )
-        {
-            for ( uint j = 0; j < domainDim; ++j )
-            {
-                g[j] = d[j];
-            }
-            for ( uint j = 0; j < rangeDim; ++j )
-            {
-                g[domainDim + j] = r[j];
-            }
-            graphPoints.PushBack( g );
-        }
+        rangePoints.Set( i, r );
+    }
+    if ( !createDomain && !createGraph )
+    {
+        domainPoints.Reset( domainDim, 0 );
+    }
+    if ( !createRange && !createGraph )
+    {
+        rangePoints.Reset( rangeDim, 0 );
+    }
+    outPoints.m_graphPoints = createGraph ? GraphPointCloud( domainPoints, rangePoints ) : GraphPointCloud();
+    outPoints.m_footprint.Update( domainPoints.GetMemoryFootprint() + rangePoints.GetMemoryFootprint() );
+}
+
+
+void LocalKernelsPersistence::CreatePoints( const PointsProxy &points, const uint *indices, uint count, uint pcfFlags, PointsProxy &outPoints )
+{
+    ProfileScope scope( "LocalKernelsPersistence::CreatePoints" );
+    PointCloud &domainPoints = outPoints.m_domainPoints;
+    PointCloud &rangePoints = outPoints.m_rangePoints;
+    const bool createGraph = pcfFlags & PCF_Graph;
+    if ( ( pcfFlags & PCF_Domain ) || createGraph )
+    {
+        domainPoints.Gather( points.m_domainPoints, indices, count );
+    }
+    else
+    {
+        domainPoints.Reset( points.m_domainPoints.GetDimension(), 0 );
+    }
+    if ( ( pcfFlags & PCF_Range ) || createGraph )
+    {
+        rangePoints.Gather( points.m_rangePoints, indices, count );
     }
+    else
+    {
+        rangePoints.Reset( points.m_rangePoints.GetDimension(), 0 );
+    }
+    outPoints.m_graphPoints = createGraph ? GraphPointCloud( domainPoints, rangePoints ) : GraphPointCloud();
+    outPoints.m_footprint.Update( domainPoints.GetMemoryFootprint() + rangePoints.GetMemoryFootprint() );
 }
 
 
-void LocalKernelsPersistence::FindEpsilons( const PointsList &graphPoints, const Metrics &metrics, double &prevEpsilon, double &epsilon, double alpha )
+void LocalKernelsPersistence::FindEpsilons( const GraphPointCloud &graphPoints, const Metrics &metrics, double &prevEpsilon, double &epsilon, double alpha )
 {
-    RipsComplex ripsGraph( graphPoints, metrics, epsilon, 1 );
+    ProfileScope scope( "LocalKernelsPersistence::FindEpsilons" );
+    RipsComplex ripsGraph( graphPoints, MetricsProbe( metrics, epsilon ).Get(), epsilon, 1 );
     ripsGraph.CreateConnectedComponents();
     while ( ripsGraph.GetConnectedComponentsNumber() > 1 )
     {
         prevEpsilon = epsilon;
         epsilon *= 2;
-        ripsGraph.Create( graphPoints, metrics, epsilon, 1 );
+        ripsGraph.Create( graphPoints, MetricsProbe( metrics, epsilon ).Get(), epsilon, 1 );
         ripsGraph.CreateConnectedComponents();
     }
-    ripsGraph.Create( graphPoints, metrics, prevEpsilon, 1 );
+    ripsGraph.Create( graphPoints, MetricsProbe( metrics, prevEpsilon ).Get(), prevEpsilon, 1 );
     ripsGraph.CreateConnectedComponents();
     while ( ripsGraph.GetConnectedComponentsNumber() == 1 )
     {
         prevEpsilon *= 0.5;
-        ripsGraph.Create( graphPoints, metrics, prevEpsilon, 1 );
+        ripsGraph.Create( graphPoints, MetricsProbe( metrics, prevEpsilon ).Get(), prevEpsilon, 1 );
         ripsGraph.CreateConnectedComponents();
     }
     while ( ( epsilon - prevEpsilon ) > alpha )
     {
         const double newEpsilon = ( epsilon + prevEpsilon ) * 0.5;
-        ripsGraph.Create( graphPoints, metrics, newEpsilon, 1 );
+        ripsGraph.Create( graphPoints, MetricsProbe( metrics, newEpsilon ).Get(), newEpsilon, 1 );
         ripsGraph.CreateConnectedComponents();
         if ( ripsGraph.GetConnectedComponentsNumber() == 1 )
         {
@@ -93,35 +172,66 @@ void LocalKernelsPersistence::FindEpsilons( const PointsList &graphPoints, const
 ////////////////////////////////////////////////////////////////////////////////
 
 void LocalKernelsPersistence::Compute_Alg1( const Domain &domain, const Map &map, const Domain &testDomain, const DynArray<double> &epsilons, double restrictionRadius,
-                                            const Metrics &domainMetrics, const Metrics &graphMetrics, PersistenceData &outPersistenceData )
+                                            const Metrics &domainMetrics, const Metrics &graphMetrics, PersistenceData &outPersistenceData, Statistics *outStatistics )
 {
+    ProfileScope scope( "LocalKernelsPersistence::Compute_Alg1" );
+    Statistics statistics;
     Point center( domain.GetDimension() );
     const uint count = testDomain.GetCount();
+    ProgressReporter progress( "Compute_Alg1", count );
+    // Temporaries of the restrictions and complexes, the results are still allocated on the heap.
+    Arena arena;
     for ( uint i = 0; i < count; ++i )
     {
+        ArenaScope arenaScope( arena );
+        ProfileScope centerScope( "TestPoint" );
+        TraceScope centerTrace( "TestPoint" );
+        PerfCounter costCounter;
+        costCounter.Reset();
+        PointPersistenceData::Cost cost;
         testDomain.GetValue( i, center );
-        DomainRestriction restriction( domain, domainMetrics, center, restrictionRadius );
+        AddTraceCenter( centerTrace, i, center );
+        const MetricsProbe restrictionMetrics( domainMetrics, restrictionRadius );
+        DomainRestriction restriction( domain, restrictionMetrics.Get(), center, restrictionRadius );
+        progress.Step( restriction.GetCount() );
         if ( restriction.GetCount() == 0 )
         {
             continue;
         }
+        statistics.m_centersCount++;
+        statistics.m_restrictionPointsCount += restriction.GetCount();
+        centerTrace.AddArg( "restriction", restriction.GetCount() );
+        cost.m_restrictionSize = restriction.GetCount();
         PointsProxy points;
         CreatePoints( domain, map, PCF_Domain | PCF_Graph, points );
-        PointsList &domainPoints = points.m_domainPoints;
-        PointsList &graphPoints = points.m_graphPoints;
+        UpdateQuantizationStatistics( points, statistics );
+        PointCloud &domainPoints = points.m_domainPoints;
+        const GraphPointCloud &graphPoints = points.m_graphPoints;
         ProjectionsList projections;
         const uint epsilonsCount = epsilons.GetSize();
         for ( uint j = 0; j < epsilonsCount; ++j )
         {
-            RipsComplex ripsComplexDomain( domainPoints, domainMetrics, epsilons[j], true );
+            ProfileScope epsilonScope( "Epsilon" );
+            TraceScope epsilonTrace( "Epsilon" );
+            epsilonTrace.AddArg( "epsilon", epsilons[j] );
+            const MetricsProbe domainComplexMetrics( domainMetrics, epsilons[j] );
+            RipsComplex ripsComplexDomain( domainPoints, domainComplexMetrics.Get(), epsilons[j], true );
             ripsComplexDomain.CreateConnectedComponents();
             const uint domainConnectedComponents = ripsComplexDomain.GetConnectedComponentsNumber();
 
-            RipsComplex ripsComplexGraph( graphPoints, graphMetrics, epsilons[j], true );
+            const MetricsProbe graphComplexMetrics( graphMetrics, epsilons[j] );
+            RipsComplex ripsComplexGraph( graphPoints, graphComplexMetrics.Get(), epsilons[j], true );
             ripsComplexGraph.CreateConnectedComponents();
             const uint graphConnectedComponents = ripsComplexGraph.GetConnectedComponentsNumber();
 
             assert( graphConnectedComponents >= domainConnectedComponents );
+            statistics.m_complexesCount += 2;
+            statistics.m_complexEdgesCount += ripsComplexDomain.GetEdgesCount() + ripsComplexGraph.GetEdgesCount();
+            statistics.m_complexPairTestsCount += ripsComplexDomain.GetStatistics().m_pairTestsCount + ripsComplexGraph.GetStatistics().m_pairTestsCount;
+            epsilonTrace.AddArg( "domain_edges", ripsComplexDomain.GetEdgesCount() );
+            epsilonTrace.AddArg( "graph_edges", ripsComplexGraph.GetEdgesCount() );
+            cost.m_domainEdgesCount += ripsComplexDomain.GetEdgesCount();
+            cost.m_graphEdgesCount += ripsComplexGraph.GetEdgesCount();
 
             Projection projection;
             ripsComplexGraph.GetProjectionMap( ripsComplexDomain, projection );
@@ -132,6 +242,12 @@ void LocalKernelsPersistence::Compute_Alg1( const Domain &domain, const Map &map
             }
         }
         outPersistenceData.PushBack( PointPersistenceData( center, projections, false ) );
+        cost.m_time = costCounter.Reset();
+        outPersistenceData.Back().SetCost( cost );
+    }
+    if ( outStatistics != nullptr )
+    {
+        *outStatistics = statistics;
     }
 }
 
@@ -144,6 +260,7 @@ public:
     MetricsProxy( const Metrics &domainMetrics, uint domainDim, uint rangeDim, const LocalKernelsPersistence::PointsProxy &points )
         : m_domainMetrics( domainMetrics )
     {
+        ProfileScope scope( "MetricsProxy" );
         if ( m_domainMetrics.HasIndexMetrics() )
         {
             m_domainIndexMetrics = m_domainMetrics.CreateIndexMetrics( points.m_domainPoints );
@@ -168,51 +285,90 @@ private:
 };
 
 
-void LocalKernelsPersistence::Compute_Alg2( const Domain &domain, const Map &map, double alpha, double beta, const Metrics &domainMetrics, PersistenceData &outPersistenceData )
+void LocalKernelsPersistence::Compute_Alg2( const Domain &domain, const Map &map, double alpha, double beta, const Metrics &domainMetrics, PersistenceData &outPersistenceData,
+                                            Statistics *outStatistics )
 {
+    ProfileScope scope( "LocalKernelsPersistence::Compute_Alg2" );
+    if ( outStatistics != nullptr )
+    {
+        *outStatistics = Statistics();
+    }
     if ( domain.GetCount() < 2 )
     {
         return;
     }
+    Statistics statistics;
     const uint domainDim = domain.GetDimension();
     const uint rangeDim = map.GetDimension();
 
     double epsilon = 0.1;
     double prevEpsilon = epsilon * 0.5;
-    PointsProxy points;
-    CreatePoints( domain, map, PCF_All, points );
-    MetricsProxy mainMetrics( domainMetrics, domainDim, rangeDim, points );
-    FindEpsilons( points.m_graphPoints, mainMetrics.GetGraphMetrics(), prevEpsilon, epsilon, alpha );
+    PointsProxy mainPoints;
+    CreatePoints( domain, map, PCF_All, mainPoints );
+    UpdateQuantizationStatistics( mainPoints, statistics );
+    MetricsProxy mainMetrics( domainMetrics, domainDim, rangeDim, mainPoints );
+    FindEpsilons( mainPoints.m_graphPoints, mainMetrics.GetGraphMetrics(), prevEpsilon, epsilon, alpha );
     epsilon = ( 1.0 + beta ) * epsilon;
 
     Point center( domain.GetDimension() );
     const uint count = domain.GetCount();
+    ProgressReporter progress( "Compute_Alg2", count );
+    Arena arena;
     for ( uint i = 0; i < count; i++ )
     {
+        ArenaScope arenaScope( arena );
+        ProfileScope centerScope( "Center" );
+        TraceScope centerTrace( "Center" );
+        PerfCounter costCounter;
+        costCounter.Reset();
         domain.GetValue( i, center );
-        DomainRestriction restriction( domain, mainMetrics.GetDomainMetrics(), center, epsilon );
+        AddTraceCenter( centerTrace, i, center );
+        const MetricsProbe restrictionMetrics( mainMetrics.GetDomainMetrics(), epsilon );
+        // Neighbourhoods refer to the points created above, so the map is evaluated once per point.
+        DomainRestriction restriction( domain, mainPoints.m_domainPoints, restrictionMetrics.Get(), center, epsilon );
+        progress.Step( restriction.GetCount() );
         if ( restriction.GetCount() == 0 )
         {
             continue;
         }
         
         PointsProxy points;
-        CreatePoints( restriction, map, PCF_All, points );
+        CreatePoints( mainPoints, restriction.GetIndices(), restriction.GetCount(), PCF_All, points );
         MetricsProxy localMetrics( domainMetrics, domainDim, rangeDim, points );
         
-        RipsComplex ripsComplexDomain( points.m_domainPoints, localMetrics.GetDomainMetrics(), epsilon, false );
+        const MetricsProbe domainComplexMetrics( localMetrics.GetDomainMetrics(), epsilon );
+        RipsComplex ripsComplexDomain( points.m_domainPoints, domainComplexMetrics.Get(), epsilon, false );
         ripsComplexDomain.CreateConnectedComponents();        
         const uint domainConnectedComponents = ripsComplexDomain.GetConnectedComponentsNumber();
         
-        RipsComplex ripsComplexGraph( points.m_graphPoints, localMetrics.GetGraphMetrics(), epsilon, false );
+        const MetricsProbe graphComplexMetrics( localMetrics.GetGraphMetrics(), epsilon );
+        RipsComplex ripsComplexGraph( points.m_graphPoints, graphComplexMetrics.Get(), epsilon, false );
         ripsComplexGraph.CreateConnectedComponents();
         const uint graphConnectedComponents = ripsComplexGraph.GetConnectedComponentsNumber();
         assert( graphConnectedComponents >= domainConnectedComponents );
+        statistics.m_centersCount++;
+        statistics.m_restrictionPointsCount += restriction.GetCount();
+        statistics.m_complexesCount += 2;
+        statistics.m_complexEdgesCount += ripsComplexDomain.GetEdgesCount() + ripsComplexGraph.GetEdgesCount();
+        statistics.m_complexPairTestsCount += ripsComplexDomain.GetStatistics().m_pairTestsCount + ripsComplexGraph.GetStatistics().m_pairTestsCount;
+        centerTrace.AddArg( "restriction", restriction.GetCount() );
+        centerTrace.AddArg( "domain_edges", ripsComplexDomain.GetEdgesCount() );
+        centerTrace.AddArg( "graph_edges", ripsComplexGraph.GetEdgesCount() );
         
         Projection projection;
         ripsComplexGraph.GetProjectionMap( ripsComplexDomain, projection );
         ProjectionsList projections;
         projections.PushBack( projection );
         outPersistenceData.PushBack( PointPersistenceData( center, projections, false ) );
+        PointPersistenceData::Cost cost;
+        cost.m_restrictionSize = restriction.GetCount();
+        cost.m_domainEdgesCount = ripsComplexDomain.GetEdgesCount();
+        cost.m_graphEdgesCount = ripsComplexGraph.GetEdgesCount();
+        cost.m_time = costCounter.Reset();
+        outPersistenceData.Back().SetCost( cost );
+    }
+    if ( outStatistics != nullptr )
+    {
+        *outStatistics = statistics;
     }
 }
@@ -2,9 +2,13 @@
 
 #pragma once
 
+#include "memoryFootprint.h"
 #include "persistenceData.h"
+#include "pointCloud.h"
 #include "Core/ptr.h"
 
+#include <cstdint>
+
 class Domain;
 class Map;
 class Metrics;
@@ -16,15 +20,46 @@ public:
 
     struct PointsProxy
     {
-        PointsList m_domainPoints;
-        PointsList m_rangePoints;
-        PointsList m_graphPoints;
+        PointCloud m_domainPoints;
+        PointCloud m_rangePoints;
+        // Views of the domain and range points.
+        GraphPointCloud m_graphPoints;
+        MemoryFootprintScope m_footprint;
+
+        PointsProxy()
+            : m_footprint( MemoryFootprint::Category::PointCloud )
+        {}
     };
 
-    static void Compute_Alg1( const Domain &domain, const Map &map, const Domain &testDomain, const o::DynArray<double> &epsilons, double restrictionRadius,
-                              const Metrics &domainMetrics, const Metrics &graphMetrics, PersistenceData &outPersistenceData );
-    static void Compute_Alg2( const Domain &domain, const Map &map, double alpha, double beta, const Metrics &domainMetrics, PersistenceData &outPersistenceData );
+    // Work done by a single computation, summed over all the centers.
+    struct Statistics
+    {
+        uint m_centersCount;
+        uint m_complexesCount;
+        uint64_t m_restrictionPointsCount;
+        uint64_t m_complexEdgesCount;
+        uint64_t m_complexPairTestsCount;
+        // Error bounds of the quantized point clouds, 0 for the clouds of other precisions.
+        double m_coordinateErrorBound;
+        double m_euclideanErrorBound;
+        uint m_clampedCoordsCount;
 
+        Statistics()
+            : m_centersCount( 0 )
+            , m_complexesCount( 0 )
+            , m_restrictionPointsCount( 0 )
+            , m_complexEdgesCount( 0 )
+            , m_complexPairTestsCount( 0 )
+            , m_coordinateErrorBound( 0.0 )
+            , m_euclideanErrorBound( 0.0 )
+            , m_clampedCoordsCount( 0 )
+        {}
+    };
+
+    static void Compute_Alg1( const Domain &domain, const Map &map, const Domain &testDomain, const o::DynArray<double> &epsilons, double restrictionRadius,
+                              const Metrics &domainMetrics, const Metrics &graphMetrics, PersistenceData &outPersistenceData, Statistics *outStatistics = nullptr );
+    static void Compute_Alg2( const Domain &domain, const Map &map, double alpha, double beta, const Metrics &domainMetrics, PersistenceData &outPersistenceData,
+                              Statistics *outStatistics = nullptr );
 
 
 private:
@@ -38,5 +73,7 @@ private:
     };
 
     static void CreatePoints( const Domain &domain, const Map &map, uint pcfFlags, PointsProxy &outPoints );
-    static void FindEpsilons( const PointsList &graphPoints, const Metrics &metrics, double &prevEpsilon, double &epsilon, double alpha );
+    // Subset of already created points, the map is not evaluated again.
+    static void CreatePoints( const PointsProxy &points, const uint *indices, uint count, uint pcfFlags, PointsProxy &outPoints );
+    static void FindEpsilons( const GraphPointCloud &graphPoints, const Metrics &metrics, double &prevEpsilon, double &epsilon, double alpha );
 };
\ No newline at end of file
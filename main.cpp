@@ -1,16 +1,16 @@
 // pbrendel (c) 2013-21
 
+#include "benchmarks.h"
 #include "Tests.h"
-#include "Core/perfCounter.h"
-
-#include <iostream>
 
 int main( int argc, char *argv[] )
 {
-    PerfCounter pc;
-    pc.Reset();
+    if ( Benchmarks::IsBenchmarkCommand( argc, argv ) )
+    {
+        return Benchmarks::Run( argc, argv );
+    }
+
     Tests::Run( argc, argv );
-    std::cout << "finished in " << pc.Reset() << " seconds" << std::endl;
 
     return 0;
 }
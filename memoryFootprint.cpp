@@ -0,0 +1,81 @@
+// pbrendel (c) 2021
+
+#include "memoryFootprint.h"
+#include "memoryUsage.h"
+#include "Core/assert.h"
+
+#include <iomanip>
+
+
+MemoryFootprint &MemoryFootprint::Get()
+{
+    static MemoryFootprint s_instance;
+    return s_instance;
+}
+
+
+MemoryFootprint::MemoryFootprint()
+    : m_pointsCount( 0 )
+{
+    for ( uint i = 0; i < static_cast<uint>( Category::Count ); ++i )
+    {
+        m_live[i] = 0;
+        m_peak[i] = 0;
+    }
+}
+
+
+void MemoryFootprint::Add( Category category, size_t bytes )
+{
+    const uint index = static_cast<uint>( category );
+    m_live[index] += bytes;
+    if ( m_live[index] > m_peak[index] )
+    {
+        m_peak[index] = m_live[index];
+    }
+}
+
+
+void MemoryFootprint::Remove( Category category, size_t bytes )
+{
+    const uint index = static_cast<uint>( category );
+    assert( m_live[index] >= bytes );
+    m_live[index] -= bytes;
+}
+
+
+void MemoryFootprint::Reset()
+{
+    for ( uint i = 0; i < static_cast<uint>( Category::Count ); ++i )
+    {
+        m_peak[i] = m_live[i];
+    }
+}
+
+
+void MemoryFootprint::Print( std::ostream &str ) const
+{
+    const char *names[] = { "PointCloud", "PersistenceData", "RipsComplex verts", "RipsComplex edges", "RipsComplex neighbours", "ExitSetQuotientMetrics", "RandomCube", "Arena" };
+    static_assert( sizeof( names ) / sizeof( names[0] ) == static_cast<uint>( Category::Count ), "category names mismatch" );
+    const double megabyte = 1024.0 * 1024.0;
+    const double points = m_pointsCount > 0 ? static_cast<double>( m_pointsCount ) : 1.0;
+    const std::streamsize precision = str.precision();
+    str << std::left << std::setw( 32 ) << "memory" << std::right
+        << std::setw( 14 ) << "live MB"
+        << std::setw( 14 ) << "peak MB"
+        << std::setw( 16 ) << "peak B/point" << std::endl;
+    str << std::fixed << std::setprecision( 2 );
+    for ( uint i = 0; i < static_cast<uint>( Category::Count ); ++i )
+    {
+        str << std::left << std::setw( 32 ) << names[i] << std::right
+            << std::setw( 14 ) << m_live[i] / megabyte
+            << std::setw( 14 ) << m_peak[i] / megabyte
+            << std::setw( 16 ) << m_peak[i] / points << std::endl;
+    }
+    str << std::left << std::setw( 32 ) << "process RSS" << std::right
+        << std::setw( 14 ) << MemoryUsage::GetCurrent() / megabyte
+        << std::setw( 14 ) << MemoryUsage::GetPeak() / megabyte
+        << std::setw( 16 ) << MemoryUsage::GetPeak() / points << std::endl;
+    str.unsetf( std::ios_base::floatfield );
+    str.precision( precision );
+}
@@ -0,0 +1,100 @@
+// pbrendel (c) 2021
+
+#pragma once
+
+#include "Core/defs.h"
+
+#include <cstddef>
+#include <ostream>
+
+
+// Bytes held by the main data structures, estimated from their sizes. Owners register their
+// memory through MemoryFootprintScope, the registry keeps the live and the peak total of each category.
+class MemoryFootprint
+{
+public:
+
+    enum class Category : uint
+    {
+        PointCloud,
+        PersistenceData,
+        RipsVerts,
+        RipsEdges,
+        RipsNeighbours,
+        ExitSetQuotientMetrics,
+        RandomCube,
+        Arena,
+        Count,
+    };
+
+    static MemoryFootprint &Get();
+
+    void Add( Category category, size_t bytes );
+    void Remove( Category category, size_t bytes );
+
+    // Peaks are reset to the current live values.
+    void Reset();
+
+    // Points of the domain, used for the per point figures.
+    void SetPointsCount( uint pointsCount )
+    {
+        m_pointsCount = pointsCount;
+    }
+
+    void Print( std::ostream &str ) const;
+
+private:
+
+    MemoryFootprint();
+
+    size_t m_live[static_cast<uint>( Category::Count )];
+    size_t m_peak[static_cast<uint>( Category::Count )];
+    uint m_pointsCount;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class MemoryFootprintScope
+{
+public:
+
+    MemoryFootprintScope( MemoryFootprint::Category category, size_t bytes = 0 )
+        : m_category( category )
+        , m_bytes( bytes )
+    {
+        MemoryFootprint::Get().Add( m_category, m_bytes );
+    }
+
+    MemoryFootprintScope( const MemoryFootprintScope &other )
+        : m_category( other.m_category )
+        , m_bytes( other.m_bytes )
+    {
+        MemoryFootprint::Get().Add( m_category, m_bytes );
+    }
+
+    ~MemoryFootprintScope()
+    {
+        MemoryFootprint::Get().Remove( m_category, m_bytes );
+    }
+
+    MemoryFootprintScope &operator=( const MemoryFootprintScope &other )
+    {
+        MemoryFootprint::Get().Remove( m_category, m_bytes );
+        m_category = other.m_category;
+        m_bytes = other.m_bytes;
+        MemoryFootprint::Get().Add( m_category, m_bytes );
+        return *this;
+    }
+
+    void Update( size_t bytes )
+    {
+        MemoryFootprint::Get().Remove( m_category, m_bytes );
+        m_bytes = bytes;
+        MemoryFootprint::Get().Add( m_category, m_bytes );
+    }
+
+private:
+
+    MemoryFootprint::Category m_category;
+    size_t m_bytes;
+};
@@ -0,0 +1,100 @@
+// pbrendel (c) 2021
+
+#include "memoryUsage.h"
+
+#if defined( _WIN32 )
+#include <windows.h>
+#include <psapi.h>
+#pragma comment( lib, "psapi.lib" )
+#else
+#include <sys/resource.h>
+#include <fstream>
+#include <string>
+#endif
+
+
+#if defined( _WIN32 )
+
+size_t MemoryUsage::GetCurrent()
+{
+    PROCESS_MEMORY_COUNTERS counters;
+    if ( GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters ) ) )
+    {
+        return counters.WorkingSetSize;
+    }
+    return 0;
+}
+
+
+size_t MemoryUsage::GetPeak()
+{
+    PROCESS_MEMORY_COUNTERS counters;
+    if ( GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters ) ) )
+    {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+}
+
+
+bool MemoryUsage::ResetPeak()
+{
+    return false;
+}
+
+#else
+
+size_t MemoryUsage::GetCurrent()
+{
+    std::ifstream status( "/proc/self/status" );
+    std::string key;
+    while ( status >> key )
+    {
+        if ( key == "VmRSS:" )
+        {
+            size_t kb = 0;
+            status >> kb;
+            return kb * 1024;
+        }
+        status.ignore( 1024, '\n' );
+    }
+    return 0;
+}
+
+
+size_t MemoryUsage::GetPeak()
+{
+    // VmHWM honours the reset done through clear_refs, ru_maxrss does not.
+    std::ifstream status( "/proc/self/status" );
+    std::string key;
+    while ( status >> key )
+    {
+        if ( key == "VmHWM:" )
+        {
+            size_t kb = 0;
+            status >> kb;
+            return kb * 1024;
+        }
+        status.ignore( 1024, '\n' );
+    }
+    struct rusage usage;
+    if ( getrusage( RUSAGE_SELF, &usage ) == 0 )
+    {
+        return static_cast<size_t>( usage.ru_maxrss ) * 1024;
+    }
+    return 0;
+}
+
+
+bool MemoryUsage::ResetPeak()
+{
+    std::ofstream clearRefs( "/proc/self/clear_refs" );
+    if ( !clearRefs.is_open() )
+    {
+        return false;
+    }
+    clearRefs << "5";
+    return clearRefs.good();
+}
+
+#endif
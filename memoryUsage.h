@@ -0,0 +1,21 @@
+// pbrendel (c) 2021
+
+#pragma once
+
+#include <cstddef>
+
+
+class MemoryUsage
+{
+public:
+
+    // Current resident set size of the process in bytes.
+    static size_t GetCurrent();
+
+    // Peak resident set size of the process in bytes.
+    static size_t GetPeak();
+
+    // Starts tracking the peak from the current usage. Not every platform supports it,
+    // the peak is monotonic over the whole process lifetime there.
+    static bool ResetPeak();
+};
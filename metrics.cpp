@@ -1,19 +1,199 @@
 // pbrendel (c) 2013-21
 
 #include "metrics.h"
+#include "simdDistance.h"
 
+#include <algorithm>
 
-double EuclideanMetrics::GetDistance( const Point &x, const Point &y, uint, uint ) const
+
+namespace
 {
-    assert( x.GetDimension() == y.GetDimension() );
-    double d = 0;
-    double tmp;
-    for ( Point::ConstIterator i = x.Begin(), j = y.Begin(); i != x.End(); ++i, ++j )
+
+// Coordinates of double precision clouds are read in place, the other precisions are converted per point.
+template <class M>
+void GetCoordsDistances( ConstPointView x, const PointCloud &points, const uint *indices, uint count, double *outDistances )
+{
+    assert( x.GetDimension() == points.GetDimension() );
+    const uint dim = x.GetDimension();
+    const double *xCoords = x.Begin();
+    if ( points.GetPrecision() == PointCloud::Precision::Double )
     {
-        tmp = *i - *j;
-        d += tmp * tmp;
+        if ( count > 0 && SimdDistance::GetDistances( M::TYPE, xCoords, points.GetCoords<double>( 0 ), dim, indices, count, outDistances ) )
+        {
+            return;
+        }
+        for ( uint k = 0; k < count; ++k )
+        {
+            outDistances[k] = M::GetCoordsDistance( xCoords, points.GetCoords<double>( indices[k] ), dim );
+        }
     }
-    return sqrt( d );
+    else
+    {
+        Point y( dim );
+        for ( uint k = 0; k < count; ++k )
+        {
+            points.GetValue( indices[k], y );
+            outDistances[k] = M::GetCoordsDistance( xCoords, y.Begin(), dim );
+        }
+    }
+}
+
+
+
+// Vectorized distances are cheaper than the early exits of the scalar predicates, so the SIMD
+// kernels are used whenever they are available.
+template <class M>
+void GetCoordsWithinDistance( ConstPointView x, const PointCloud &points, const uint *indices, uint count, double threshold, uint32_t *outMask )
+{
+    assert( x.GetDimension() == points.GetDimension() );
+    const uint dim = x.GetDimension();
+    const double *xCoords = x.Begin();
+    const bool inPlace = points.GetPrecision() == PointCloud::Precision::Double;
+    if ( inPlace && SimdDistance::Get() != SimdDistance::InstructionSet::Scalar )
+    {
+        double distances[Metrics::BATCH_SIZE];
+        for ( uint first = 0; first < count; first += Metrics::BATCH_SIZE )
+        {
+            const uint blockCount = std::min( count - first, static_cast<uint>( Metrics::BATCH_SIZE ) );
+            SimdDistance::GetDistances( M::TYPE, xCoords, points.GetCoords<double>( 0 ), dim, indices + first, blockCount, distances );
+            Metrics::GetWithinMask( distances, blockCount, threshold, outMask + first / 32 );
+        }
+        return;
+    }
+    std::fill_n( outMask, ( count + 31 ) / 32, 0 );
+    Point y( inPlace ? 0 : dim );
+    for ( uint k = 0; k < count; ++k )
+    {
+        if ( !inPlace )
+        {
+            points.GetValue( indices[k], y );
+        }
+        const bool within = M::IsWithinCoordsDistance( xCoords, inPlace ? points.GetCoords<double>( indices[k] ) : y.Begin(), dim, threshold );
+        if ( within )
+        {
+            outMask[k / 32] |= 1u << ( k % 32 );
+        }
+    }
+}
+
+} // namespace
+
+
+double Metrics::GetGraphDistance( ConstPointView xDomain, ConstPointView xRange, ConstPointView yDomain, ConstPointView yRange, uint i, uint j ) const
+{
+    assert( xDomain.GetDimension() == yDomain.GetDimension() );
+    assert( xRange.GetDimension() == yRange.GetDimension() );
+    const uint domainDim = xDomain.GetDimension();
+    Point x( domainDim + xRange.GetDimension() );
+    Point y( domainDim + yRange.GetDimension() );
+    std::copy( xDomain.Begin(), xDomain.End(), x.Begin() );
+    std::copy( xRange.Begin(), xRange.End(), x.Begin() + domainDim );
+    std::copy( yDomain.Begin(), yDomain.End(), y.Begin() );
+    std::copy( yRange.Begin(), yRange.End(), y.Begin() + domainDim );
+    return GetDistance( x, y, i, j );
+}
+
+
+bool Metrics::WithinDistance( ConstPointView x, ConstPointView y, uint i, uint j, double threshold ) const
+{
+    return GetDistance( x, y, i, j ) <= threshold;
+}
+
+
+bool Metrics::WithinGraphDistance( ConstPointView xDomain, ConstPointView xRange, ConstPointView yDomain, ConstPointView yRange, uint i, uint j, double threshold ) const
+{
+    return GetGraphDistance( xDomain, xRange, yDomain, yRange, i, j ) <= threshold;
+}
+
+
+// Points of clouds of any precision are copied out, see PointCloud::GetValue.
+void Metrics::GetDistances( ConstPointView x, uint i, const PointCloud &points, const uint *indices, uint count, double *outDistances ) const
+{
+    Point y( points.GetDimension() );
+    for ( uint k = 0; k < count; ++k )
+    {
+        points.GetValue( indices[k], y );
+        outDistances[k] = GetDistance( x, y, i, indices[k] );
+    }
+}
+
+
+void Metrics::GetGraphDistances( ConstPointView xDomain, ConstPointView xRange, uint i, const GraphPointCloud &points, const uint *indices, uint count, double *outDistances ) const
+{
+    const PointCloud &domainPoints = points.GetDomainPoints();
+    const PointCloud &rangePoints = points.GetRangePoints();
+    Point yDomain( domainPoints.GetDimension() );
+    Point yRange( rangePoints.GetDimension() );
+    for ( uint k = 0; k < count; ++k )
+    {
+        domainPoints.GetValue( indices[k], yDomain );
+        rangePoints.GetValue( indices[k], yRange );
+        outDistances[k] = GetGraphDistance( xDomain, xRange, yDomain, yRange, i, indices[k] );
+    }
+}
+
+
+void Metrics::GetWithinDistance( ConstPointView x, uint i, const PointCloud &points, const uint *indices, uint count, double threshold, uint32_t *outMask ) const
+{
+    double distances[BATCH_SIZE];
+    for ( uint first = 0; first < count; first += BATCH_SIZE )
+    {
+        const uint blockCount = std::min( count - first, static_cast<uint>( BATCH_SIZE ) );
+        GetDistances( x, i, points, indices + first, blockCount, distances );
+        GetWithinMask( distances, blockCount, threshold, outMask + first / 32 );
+    }
+}
+
+
+void Metrics::GetGraphWithinDistance( ConstPointView xDomain, ConstPointView xRange, uint i, const GraphPointCloud &points, const uint *indices, uint count, double threshold, uint32_t *outMask ) const
+{
+    double distances[BATCH_SIZE];
+    for ( uint first = 0; first < count; first += BATCH_SIZE )
+    {
+        const uint blockCount = std::min( count - first, static_cast<uint>( BATCH_SIZE ) );
+        GetGraphDistances( xDomain, xRange, i, points, indices + first, blockCount, distances );
+        GetWithinMask( distances, blockCount, threshold, outMask + first / 32 );
+    }
+}
+
+
+void Metrics::GetWithinMask( const double *distances, uint count, double threshold, uint32_t *outMask )
+{
+    std::fill_n( outMask, ( count + 31 ) / 32, 0 );
+    for ( uint k = 0; k < count; ++k )
+    {
+        if ( distances[k] <= threshold )
+        {
+            outMask[k / 32] |= 1u << ( k % 32 );
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+double EuclideanMetrics::GetDistance( ConstPointView x, ConstPointView y, uint, uint ) const
+{
+    assert( x.GetDimension() == y.GetDimension() );
+    return GetCoordsDistance( x.Begin(), y.Begin(), x.GetDimension() );
+}
+
+
+void EuclideanMetrics::GetDistances( ConstPointView x, uint, const PointCloud &points, const uint *indices, uint count, double *outDistances ) const
+{
+    GetCoordsDistances<EuclideanMetrics>( x, points, indices, count, outDistances );
+}
+
+
+bool EuclideanMetrics::WithinDistance( ConstPointView x, ConstPointView y, uint, uint, double threshold ) const
+{
+    assert( x.GetDimension() == y.GetDimension() );
+    return IsWithinCoordsDistance( x.Begin(), y.Begin(), x.GetDimension(), threshold );
+}
+
+
+void EuclideanMetrics::GetWithinDistance( ConstPointView x, uint, const PointCloud &points, const uint *indices, uint count, double threshold, uint32_t *outMask ) const
+{
+    GetCoordsWithinDistance<EuclideanMetrics>( x, points, indices, count, threshold, outMask );
 }
 
 
@@ -26,15 +206,29 @@ const EuclideanMetrics &EuclideanMetrics::Get()
 
 ////////////////////////////////////////////////////////////////////////////////
 
-double MaxMetrics::GetDistance( const Point &x, const Point &y, uint, uint ) const
+double MaxMetrics::GetDistance( ConstPointView x, ConstPointView y, uint, uint ) const
 {
     assert( x.GetDimension() == y.GetDimension() );
-    double d = 0;
-    for ( Point::ConstIterator i = x.Begin(), j = y.Begin(); i != x.End(); ++i, ++j )
-    {
-        d = std::max( d, *i - *j );
-    }
-    return d;
+    return GetCoordsDistance( x.Begin(), y.Begin(), x.GetDimension() );
+}
+
+
+void MaxMetrics::GetDistances( ConstPointView x, uint, const PointCloud &points, const uint *indices, uint count, double *outDistances ) const
+{
+    GetCoordsDistances<MaxMetrics>( x, points, indices, count, outDistances );
+}
+
+
+bool MaxMetrics::WithinDistance( ConstPointView x, ConstPointView y, uint, uint, double threshold ) const
+{
+    assert( x.GetDimension() == y.GetDimension() );
+    return IsWithinCoordsDistance( x.Begin(), y.Begin(), x.GetDimension(), threshold );
+}
+
+
+void MaxMetrics::GetWithinDistance( ConstPointView x, uint, const PointCloud &points, const uint *indices, uint count, double threshold, uint32_t *outMask ) const
+{
+    GetCoordsWithinDistance<MaxMetrics>( x, points, indices, count, threshold, outMask );
 }
 
 
@@ -46,15 +240,29 @@ const MaxMetrics &MaxMetrics::Get()
 
 ////////////////////////////////////////////////////////////////////////////////
 
-double TaxiMetrics::GetDistance( const Point &x, const Point &y, uint, uint ) const
+double TaxiMetrics::GetDistance( ConstPointView x, ConstPointView y, uint, uint ) const
 {
     assert( x.GetDimension() == y.GetDimension() );
-    double d = 0;
-    for ( Point::ConstIterator i = x.Begin(), j = y.Begin(); i != x.End(); ++i, ++j )
-    {
-        d += abs( *i - *j );
-    }
-    return d;
+    return GetCoordsDistance( x.Begin(), y.Begin(), x.GetDimension() );
+}
+
+
+void TaxiMetrics::GetDistances( ConstPointView x, uint, const PointCloud &points, const uint *indices, uint count, double *outDistances ) const
+{
+    GetCoordsDistances<TaxiMetrics>( x, points, indices, count, outDistances );
+}
+
+
+bool TaxiMetrics::WithinDistance( ConstPointView x, ConstPointView y, uint, uint, double threshold ) const
+{
+    assert( x.GetDimension() == y.GetDimension() );
+    return IsWithinCoordsDistance( x.Begin(), y.Begin(), x.GetDimension(), threshold );
+}
+
+
+void TaxiMetrics::GetWithinDistance( ConstPointView x, uint, const PointCloud &points, const uint *indices, uint count, double threshold, uint32_t *outMask ) const
+{
+    GetCoordsWithinDistance<TaxiMetrics>( x, points, indices, count, threshold, outMask );
 }
 
 
@@ -66,29 +274,78 @@ const TaxiMetrics &TaxiMetrics::Get()
 
 ////////////////////////////////////////////////////////////////////////////////
 
-double MaxDomainRangeMetrics::GetDistance( const Point &x, const Point &y, uint i, uint j ) const
+double MaxDomainRangeMetrics::GetDistance( ConstPointView x, ConstPointView y, uint i, uint j ) const
 {
     assert( x.GetDimension() == y.GetDimension() );
     assert( x.GetDimension() == ( m_domainDim + m_rangeDim ) );
 
-    Point vx( m_domainDim );
-    Point vy( m_domainDim );
-    uint index = 0;
-    while ( index < m_domainDim )
+    const double *xData = x.Begin();
+    const double *yData = y.Begin();
+    return GetGraphDistance( ConstPointView( xData, m_domainDim ), ConstPointView( xData + m_domainDim, m_rangeDim ),
+                             ConstPointView( yData, m_domainDim ), ConstPointView( yData + m_domainDim, m_rangeDim ), i, j );
+}
+
+
+double MaxDomainRangeMetrics::GetGraphDistance( ConstPointView xDomain, ConstPointView xRange, ConstPointView yDomain, ConstPointView yRange, uint i, uint j ) const
+{
+    assert( xDomain.GetDimension() == m_domainDim && yDomain.GetDimension() == m_domainDim );
+    assert( xRange.GetDimension() == m_rangeDim && yRange.GetDimension() == m_rangeDim );
+    const double distDomain = m_domainMetrics.GetDistance( xDomain, yDomain, i, j );
+    return std::max( distDomain, m_rangeMetrics.GetDistance( xRange, yRange, i, j ) );
+}
+
+
+// The range distances are computed in blocks next to the domain ones, so no memory is allocated.
+void MaxDomainRangeMetrics::GetGraphDistances( ConstPointView xDomain, ConstPointView xRange, uint i, const GraphPointCloud &points, const uint *indices, uint count, double *outDistances ) const
+{
+    assert( xDomain.GetDimension() == m_domainDim && xRange.GetDimension() == m_rangeDim );
+    m_domainMetrics.GetDistances( xDomain, i, points.GetDomainPoints(), indices, count, outDistances );
+    double rangeDistances[BATCH_SIZE];
+    for ( uint first = 0; first < count; first += BATCH_SIZE )
     {
-        vx[index] = x[index];
-        vy[index] = y[index];
-        index++;
+        const uint blockCount = std::min( count - first, static_cast<uint>( BATCH_SIZE ) );
+        m_rangeMetrics.GetDistances( xRange, i, points.GetRangePoints(), indices + first, blockCount, rangeDistances );
+        for ( uint k = 0; k < blockCount; ++k )
+        {
+            outDistances[first + k] = std::max( outDistances[first + k], rangeDistances[k] );
+        }
     }
-    const double distDomain = m_domainMetrics.GetDistance( vx, vy, i, j );
-    vx.Resize( m_rangeDim );
-    vy.Resize( m_rangeDim );
-    index = 0;
-    while ( index < m_rangeDim )
+}
+
+
+bool MaxDomainRangeMetrics::WithinDistance( ConstPointView x, ConstPointView y, uint i, uint j, double threshold ) const
+{
+    assert( x.GetDimension() == y.GetDimension() );
+    assert( x.GetDimension() == ( m_domainDim + m_rangeDim ) );
+
+    const double *xData = x.Begin();
+    const double *yData = y.Begin();
+    return WithinGraphDistance( ConstPointView( xData, m_domainDim ), ConstPointView( xData + m_domainDim, m_rangeDim ),
+                                ConstPointView( yData, m_domainDim ), ConstPointView( yData + m_domainDim, m_rangeDim ), i, j, threshold );
+}
+
+
+bool MaxDomainRangeMetrics::WithinGraphDistance( ConstPointView xDomain, ConstPointView xRange, ConstPointView yDomain, ConstPointView yRange, uint i, uint j, double threshold ) const
+{
+    assert( xDomain.GetDimension() == m_domainDim && yDomain.GetDimension() == m_domainDim );
+    assert( xRange.GetDimension() == m_rangeDim && yRange.GetDimension() == m_rangeDim );
+    return m_domainMetrics.WithinDistance( xDomain, yDomain, i, j, threshold ) && m_rangeMetrics.WithinDistance( xRange, yRange, i, j, threshold );
+}
+
+
+// The range metrics are called only for the words of the mask with some points within the threshold in the domain.
+void MaxDomainRangeMetrics::GetGraphWithinDistance( ConstPointView xDomain, ConstPointView xRange, uint i, const GraphPointCloud &points, const uint *indices, uint count, double threshold, uint32_t *outMask ) const
+{
+    assert( xDomain.GetDimension() == m_domainDim && xRange.GetDimension() == m_rangeDim );
+    m_domainMetrics.GetWithinDistance( xDomain, i, points.GetDomainPoints(), indices, count, threshold, outMask );
+    for ( uint first = 0; first < count; first += 32 )
     {
-        vx[index] = x[index + m_domainDim];
-        vy[index] = y[index + m_domainDim];
-        index++;
+        uint32_t &mask = outMask[first / 32];
+        if ( mask != 0 )
+        {
+            uint32_t rangeMask = 0;
+            m_rangeMetrics.GetWithinDistance( xRange, i, points.GetRangePoints(), indices + first, std::min( count - first, 32u ), threshold, &rangeMask );
+            mask &= rangeMask;
+        }
     }
-    return std::max( distDomain, m_rangeMetrics.GetDistance( vx, vy, i, j ) );
 }
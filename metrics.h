@@ -2,10 +2,14 @@
 
 #pragma once
 
-#include "point.h"
+#include "fixedPoint.h"
+#include "pointCloud.h"
 #include "Core/types.h"
 #include "Core/ptr.h"
 
+#include <cstdint>
+#include <limits>
+
 
 class IndexMetrics;
 
@@ -17,17 +21,51 @@ public:
     enum : uint
     {
         NO_INDEX = static_cast<uint>( -1 ),
+        // Callers iterating over a whole cloud pass it to the batch calls in blocks of that many points.
+        BATCH_SIZE = 256,
+    };
+
+    // Metrics with a known type can be evaluated by the fixed dimension kernels, see DispatchDistance.
+    enum class Type
+    {
+        Generic,
+        Euclidean,
+        Max,
+        Taxi,
+        MaxDomainRange,
     };
 
     virtual ~Metrics()
     {}
     
-    virtual double GetDistance( const Point &x, const Point &y, uint i, uint j ) const = 0;
+    virtual double GetDistance( ConstPointView x, ConstPointView y, uint i, uint j ) const = 0;
+    // Distance of graph points given by their domain and range parts. By default the parts are
+    // concatenated, MaxDomainRangeMetrics reads them in place.
+    virtual double GetGraphDistance( ConstPointView xDomain, ConstPointView xRange, ConstPointView yDomain, ConstPointView yRange, uint i, uint j ) const;
+
+    // Whether GetDistance( x, y, i, j ) <= threshold. Metrics may decide it without computing the
+    // whole distance, but the answer is always the same as the comparison of the distance.
+    virtual bool WithinDistance( ConstPointView x, ConstPointView y, uint i, uint j, double threshold ) const;
+    virtual bool WithinGraphDistance( ConstPointView xDomain, ConstPointView xRange, ConstPointView yDomain, ConstPointView yRange, uint i, uint j, double threshold ) const;
+
+    // Batch counterparts of GetDistance and GetGraphDistance, outDistances[k] is the distance from x to
+    // the point indices[k] of the cloud, which is also its index j. One virtual call serves all the points.
+    virtual void GetDistances( ConstPointView x, uint i, const PointCloud &points, const uint *indices, uint count, double *outDistances ) const;
+    virtual void GetGraphDistances( ConstPointView xDomain, ConstPointView xRange, uint i, const GraphPointCloud &points, const uint *indices, uint count, double *outDistances ) const;
+    // Sets bit k % 32 of outMask[k / 32] if the distance to the point indices[k] is not greater than
+    // the threshold, clears it otherwise. The mask holds ( count + 31 ) / 32 words.
+    virtual void GetWithinDistance( ConstPointView x, uint i, const PointCloud &points, const uint *indices, uint count, double threshold, uint32_t *outMask ) const;
+    virtual void GetGraphWithinDistance( ConstPointView xDomain, ConstPointView xRange, uint i, const GraphPointCloud &points, const uint *indices, uint count, double threshold, uint32_t *outMask ) const;
+    static void GetWithinMask( const double *distances, uint count, double threshold, uint32_t *outMask );
+
+    virtual Type GetType() const { return Type::Generic; }
 
     virtual bool IsIndexMetrics() const { return false; }
     virtual bool HasIndexMetrics() const { return false; }
-    virtual o::Ptr<IndexMetrics> CreateIndexMetrics( const PointsList &points ) const { return nullptr; }
-    virtual void ResetIndexMetrics( const PointsList &points ) { assertex( false, "Not implemented" ); }
+    // Metrics recognizing the points by exact coordinates do not work with single precision clouds.
+    virtual bool RequiresDoublePrecision() const { return false; }
+    virtual o::Ptr<IndexMetrics> CreateIndexMetrics( const PointCloud &points ) const { return nullptr; }
+    virtual void ResetIndexMetrics( const PointCloud &points ) { assertex( false, "Not implemented" ); }
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -45,7 +83,105 @@ class EuclideanMetrics : public Metrics
 {
 public:
 
-    virtual double GetDistance( const Point &x, const Point &y, uint, uint ) const override;
+    static constexpr Type TYPE = Type::Euclidean;
+
+    // Decides whether the square root of a sum of squares is within the threshold. Sums outside of the
+    // margin around the squared threshold are decided without the square root, the margin is far wider
+    // than the rounding error of the squared threshold, so the answer is the same as sqrt( sum ) <= threshold.
+    class SquaredThreshold
+    {
+    public:
+
+        explicit SquaredThreshold( double threshold )
+            : m_threshold( threshold )
+        {
+            const double squared = threshold * threshold;
+            if ( !( threshold >= 0 ) )
+            {
+                m_lower = -std::numeric_limits<double>::infinity();
+                m_upper = -std::numeric_limits<double>::infinity();
+            }
+            else if ( squared >= 1e-290 )
+            {
+                m_lower = squared * ( 1.0 - 1e-12 );
+                m_upper = squared * ( 1.0 + 1e-12 );
+            }
+            else
+            {
+                // The square of a tiny threshold is not accurate, only the zero one is decided directly.
+                m_lower = 0.0;
+                m_upper = threshold == 0 ? 0.0 : std::numeric_limits<double>::infinity();
+            }
+        }
+
+        // Partial sums only grow, so a sum beyond the threshold can be rejected before it is complete.
+        bool IsBeyond( double sum ) const
+        {
+            return sum > m_upper;
+        }
+
+        bool IsWithin( double sum ) const
+        {
+            return sum < m_lower || ( sum <= m_upper && sqrt( sum ) <= m_threshold );
+        }
+
+    private:
+
+        double m_threshold;
+        double m_lower;
+        double m_upper;
+    };
+
+    virtual double GetDistance( ConstPointView x, ConstPointView y, uint, uint ) const override;
+    virtual void GetDistances( ConstPointView x, uint, const PointCloud &points, const uint *indices, uint count, double *outDistances ) const override;
+    virtual bool WithinDistance( ConstPointView x, ConstPointView y, uint, uint, double threshold ) const override;
+    virtual void GetWithinDistance( ConstPointView x, uint, const PointCloud &points, const uint *indices, uint count, double threshold, uint32_t *outMask ) const override;
+    virtual Type GetType() const override { return TYPE; }
+
+    static bool IsWithinCoordsDistance( const double *x, const double *y, uint dim, double threshold )
+    {
+        const SquaredThreshold squaredThreshold( threshold );
+        double d = 0;
+        for ( uint i = 0; i < dim; ++i )
+        {
+            const double tmp = x[i] - y[i];
+            d += tmp * tmp;
+            if ( squaredThreshold.IsBeyond( d ) )
+            {
+                return false;
+            }
+        }
+        return squaredThreshold.IsWithin( d );
+    }
+
+    static double GetCoordsDistance( const double *x, const double *y, uint dim )
+    {
+        double d = 0;
+        for ( uint i = 0; i < dim; ++i )
+        {
+            const double tmp = x[i] - y[i];
+            d += tmp * tmp;
+        }
+        return sqrt( d );
+    }
+
+    template <uint DIM>
+    static bool IsWithinFixedDistance( const FixedPoint<DIM> &x, const FixedPoint<DIM> &y, double threshold )
+    {
+        return IsWithinCoordsDistance( x.GetData(), y.GetData(), DIM, threshold );
+    }
+
+    template <uint DIM>
+    static double GetFixedDistance( const FixedPoint<DIM> &x, const FixedPoint<DIM> &y )
+    {
+        double d = 0;
+        for ( uint i = 0; i < DIM; ++i )
+        {
+            const double tmp = x[i] - y[i];
+            d += tmp * tmp;
+        }
+        return sqrt( d );
+    }
 
     static const EuclideanMetrics &Get();
 };
@@ -56,7 +192,55 @@ class MaxMetrics : public Metrics
 {
 public:
 
-    virtual double GetDistance( const Point &x, const Point &y, uint, uint ) const override;
+    static constexpr Type TYPE = Type::Max;
+
+    virtual double GetDistance( ConstPointView x, ConstPointView y, uint, uint ) const override;
+    virtual void GetDistances( ConstPointView x, uint, const PointCloud &points, const uint *indices, uint count, double *outDistances ) const override;
+    virtual bool WithinDistance( ConstPointView x, ConstPointView y, uint, uint, double threshold ) const override;
+    virtual void GetWithinDistance( ConstPointView x, uint, const PointCloud &points, const uint *indices, uint count, double threshold, uint32_t *outMask ) const override;
+    virtual Type GetType() const override { return TYPE; }
+
+    // Terms are not negative, so the accumulation stops as soon as the threshold is exceeded.
+    static bool IsWithinCoordsDistance( const double *x, const double *y, uint dim, double threshold )
+    {
+        double d = 0;
+        for ( uint i = 0; i < dim; ++i )
+        {
+            d = std::max( d, x[i] - y[i] );
+            if ( d > threshold )
+            {
+                return false;
+            }
+        }
+        return d <= threshold;
+    }
+
+    static double GetCoordsDistance( const double *x, const double *y, uint dim )
+    {
+        double d = 0;
+        for ( uint i = 0; i < dim; ++i )
+        {
+            d = std::max( d, x[i] - y[i] );
+        }
+        return d;
+    }
+
+    template <uint DIM>
+    static bool IsWithinFixedDistance( const FixedPoint<DIM> &x, const FixedPoint<DIM> &y, double threshold )
+    {
+        return IsWithinCoordsDistance( x.GetData(), y.GetData(), DIM, threshold );
+    }
+
+    template <uint DIM>
+    static double GetFixedDistance( const FixedPoint<DIM> &x, const FixedPoint<DIM> &y )
+    {
+        double d = 0;
+        for ( uint i = 0; i < DIM; ++i )
+        {
+            d = std::max( d, x[i] - y[i] );
+        }
+        return d;
+    }
 
     static const MaxMetrics &Get();
 };
@@ -67,7 +251,55 @@ class TaxiMetrics : public Metrics
 {
 public:
 
-    virtual double GetDistance( const Point &x, const Point &y, uint, uint ) const override;
+    static constexpr Type TYPE = Type::Taxi;
+
+    virtual double GetDistance( ConstPointView x, ConstPointView y, uint, uint ) const override;
+    virtual void GetDistances( ConstPointView x, uint, const PointCloud &points, const uint *indices, uint count, double *outDistances ) const override;
+    virtual bool WithinDistance( ConstPointView x, ConstPointView y, uint, uint, double threshold ) const override;
+    virtual void GetWithinDistance( ConstPointView x, uint, const PointCloud &points, const uint *indices, uint count, double threshold, uint32_t *outMask ) const override;
+    virtual Type GetType() const override { return TYPE; }
+
+    // Terms are not negative, so the accumulation stops as soon as the threshold is exceeded.
+    static bool IsWithinCoordsDistance( const double *x, const double *y, uint dim, double threshold )
+    {
+        double d = 0;
+        for ( uint i = 0; i < dim; ++i )
+        {
+            d += abs( x[i] - y[i] );
+            if ( d > threshold )
+            {
+                return false;
+            }
+        }
+        return d <= threshold;
+    }
+
+    static double GetCoordsDistance( const double *x, const double *y, uint dim )
+    {
+        double d = 0;
+        for ( uint i = 0; i < dim; ++i )
+        {
+            d += abs( x[i] - y[i] );
+        }
+        return d;
+    }
+
+    template <uint DIM>
+    static bool IsWithinFixedDistance( const FixedPoint<DIM> &x, const FixedPoint<DIM> &y, double threshold )
+    {
+        return IsWithinCoordsDistance( x.GetData(), y.GetData(), DIM, threshold );
+    }
+
+    template <uint DIM>
+    static double GetFixedDistance( const FixedPoint<DIM> &x, const FixedPoint<DIM> &y )
+    {
+        double d = 0;
+        for ( uint i = 0; i < DIM; ++i )
+        {
+            d += abs( x[i] - y[i] );
+        }
+        return d;
+    }
 
     static const TaxiMetrics &Get();
 };
@@ -85,7 +317,32 @@ public:
         , m_rangeDim( rangeDim )
     {}
 
-    virtual double GetDistance( const Point &x, const Point &y, uint i, uint j ) const override;
+    virtual double GetDistance( ConstPointView x, ConstPointView y, uint i, uint j ) const override;
+    virtual double GetGraphDistance( ConstPointView xDomain, ConstPointView xRange, ConstPointView yDomain, ConstPointView yRange, uint i, uint j ) const override;
+    virtual void GetGraphDistances( ConstPointView xDomain, ConstPointView xRange, uint i, const GraphPointCloud &points, const uint *indices, uint count, double *outDistances ) const override;
+    // The range part is evaluated only for the points within the threshold in the domain.
+    virtual bool WithinDistance( ConstPointView x, ConstPointView y, uint i, uint j, double threshold ) const override;
+    virtual bool WithinGraphDistance( ConstPointView xDomain, ConstPointView xRange, ConstPointView yDomain, ConstPointView yRange, uint i, uint j, double threshold ) const override;
+    virtual void GetGraphWithinDistance( ConstPointView xDomain, ConstPointView xRange, uint i, const GraphPointCloud &points, const uint *indices, uint count, double threshold, uint32_t *outMask ) const override;
+    virtual Type GetType() const override { return Type::MaxDomainRange; }
+
+    const Metrics &GetDomainMetrics() const { return m_domainMetrics; }
+    const Metrics &GetRangeMetrics() const { return m_rangeMetrics; }
+    uint GetDomainDimension() const { return m_domainDim; }
+    uint GetRangeDimension() const { return m_rangeDim; }
+
+    template <class DomainMetrics, class RangeMetrics, uint DOMAIN_DIM, uint RANGE_DIM>
+    static double GetFixedDistance( const FixedPoint<DOMAIN_DIM> &xDomain, const FixedPoint<RANGE_DIM> &xRange, const FixedPoint<DOMAIN_DIM> &yDomain, const FixedPoint<RANGE_DIM> &yRange )
+    {
+        const double distDomain = DomainMetrics::GetFixedDistance( xDomain, yDomain );
+        return std::max( distDomain, RangeMetrics::GetFixedDistance( xRange, yRange ) );
+    }
+
+    template <class DomainMetrics, class RangeMetrics, uint DOMAIN_DIM, uint RANGE_DIM>
+    static bool IsWithinFixedDistance( const FixedPoint<DOMAIN_DIM> &xDomain, const FixedPoint<RANGE_DIM> &xRange, const FixedPoint<DOMAIN_DIM> &yDomain, const FixedPoint<RANGE_DIM> &yRange, double threshold )
+    {
+        return DomainMetrics::IsWithinFixedDistance( xDomain, yDomain, threshold ) && RangeMetrics::IsWithinFixedDistance( xRange, yRange, threshold );
+    }
 
 private:
 
@@ -2,6 +2,7 @@
 
 #include "persistenceData.h"
 #include "map.h"
+#include "profiler.h"
 #include "qualityFunction.h"
 #include "Core/set.h"
 
@@ -16,6 +17,7 @@ PersistenceDiagram::PersistenceDiagram( PersistenceDiagram &&other )
 
 PersistenceDiagram::PersistenceDiagram( const ProjectionsList &projections )
 {
+    ProfileScope scope( "PersistenceDiagram" );
     typedef o::Set<uint> Range;
     typedef DynArray<uint> Kernel;
     DynArray<Kernel> kernels;
@@ -75,6 +77,7 @@ PointPersistenceData::PointPersistenceData( PointPersistenceData &&other )
     , m_persistenceDiagram( std::move( other.m_persistenceDiagram ) )
     , m_quality( other.m_quality )
     , m_discontinuity( other.m_discontinuity )
+    , m_cost( other.m_cost )
 {
 }
 
@@ -89,6 +92,7 @@ PointPersistenceData::PointPersistenceData( const Point &argument, const Project
 
 void PointPersistenceData::ApplyMap( const Map &map )
 {
+    ProfileScope scope( "PointPersistenceData::ApplyMap" );
     m_value.Resize( map.GetDimension() );
     map.GetValue( m_argument, m_value );
 }
@@ -96,5 +100,30 @@ void PointPersistenceData::ApplyMap( const Map &map )
 
 void PointPersistenceData::CalculateQuality( const QualityFunction &qualityFunction )
 {
+    ProfileScope scope( "PointPersistenceData::CalculateQuality" );
     m_quality = qualityFunction.Calculate( *m_persistenceDiagram );
 }
+
+
+size_t PointPersistenceData::GetMemoryFootprint() const
+{
+    // Points are members, only their coordinates live outside of the object.
+    size_t bytes = sizeof( PointPersistenceData ) + m_argument.GetMemoryFootprint() + m_value.GetMemoryFootprint() - 2 * sizeof( Point );
+    if ( m_persistenceDiagram.Get() != nullptr )
+    {
+        bytes += m_persistenceDiagram->GetMemoryFootprint();
+    }
+    return bytes;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+size_t GetMemoryFootprint( const PersistenceData &persistenceData )
+{
+    size_t bytes = 0;
+    for ( PersistenceData::ConstIterator it = persistenceData.Begin(); it != persistenceData.End(); ++it )
+    {
+        bytes += it->GetMemoryFootprint();
+    }
+    return bytes;
+}
@@ -39,6 +39,11 @@ public:
     Iterator Begin() const { return m_homologyClasses.Begin(); }
     Iterator End() const { return m_homologyClasses.End(); }
 
+    size_t GetMemoryFootprint() const
+    {
+        return sizeof( PersistenceDiagram ) + m_homologyClasses.GetSize() * sizeof( HomologyClass );
+    }
+
 private:
 
     o::DynArray<HomologyClass> m_homologyClasses;
@@ -52,6 +57,22 @@ class PointPersistenceData
 {
 public:
 
+    // Work spent on the point by the algorithm, edges are summed over all the epsilons.
+    struct Cost
+    {
+        double m_time;
+        uint m_restrictionSize;
+        uint m_domainEdgesCount;
+        uint m_graphEdgesCount;
+
+        Cost()
+            : m_time( 0.0 )
+            , m_restrictionSize( 0 )
+            , m_domainEdgesCount( 0 )
+            , m_graphEdgesCount( 0 )
+        {}
+    };
+
     PointPersistenceData( PointPersistenceData &&other );
     PointPersistenceData( const Point &argument, const ProjectionsList &projections, bool discontinuity );
 
@@ -63,6 +84,18 @@ public:
     void ApplyMap( const Map &map );
     void CalculateQuality( const QualityFunction &qualityFunction );
 
+    const Cost &GetCost() const
+    {
+        return m_cost;
+    }
+
+    void SetCost( const Cost &cost )
+    {
+        m_cost = cost;
+    }
+
+    size_t GetMemoryFootprint() const;
+
 private:
 
     Point m_argument;
@@ -70,6 +103,7 @@ private:
     o::Ptr<PersistenceDiagram> m_persistenceDiagram;
     double m_quality;
     bool m_discontinuity;
+    Cost m_cost;
 
     friend class DataWriter;
 };
@@ -77,3 +111,5 @@ private:
 ////////////////////////////////////////////////////////////////////////////////
 
 typedef o::DynArray<PointPersistenceData> PersistenceData;
+
+size_t GetMemoryFootprint( const PersistenceData &persistenceData );
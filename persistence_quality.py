@@ -8,29 +8,38 @@ y = []
 z = []
 quality = []
 
-if len( sys.argv ) == 2:
+# Passing "cost" as the second argument colors the points by the time spent on them,
+# the results have to be written with the --cost option then.
+if len( sys.argv ) >= 2:
     inputFilename = sys.argv[1]
 else:
     inputFilename = "res.txt";
+showCost = len( sys.argv ) == 3 and sys.argv[2] == "cost"
 
 
 fp = open( inputFilename, "r" )
 line = fp.readline()
 while line:
     tokens = line.split( " " )
-    if len( tokens ) == 5:
+    # Cost columns: time, restriction size, domain edges, graph edges.
+    hasCost = len( tokens ) == 9 or len( tokens ) == 10
+    if len( tokens ) == 5 or len( tokens ) == 9:
         x.append( float( tokens[0] ) )
         y.append( float( tokens[1] ) )
         z.append( float( tokens[2] ) )
-        quality.append( float( tokens[3] ) )
-    elif len( tokens ) == 6:
+        quality.append( float( tokens[5] if showCost and hasCost else tokens[3] ) )
+    elif len( tokens ) == 6 or len( tokens ) == 10:
         x.append( float( tokens[2] ) )
         y.append( float( tokens[3] ) )
         z.append( 0 )
-        quality.append( float( tokens[4] ) )
+        quality.append( float( tokens[6] if showCost and hasCost else tokens[4] ) )
     line = fp.readline()
 fp.close()
 
+if showCost and len( quality ) > 0 and max( quality ) > 0:
+    maxCost = max( quality )
+    quality = [ i / maxCost for i in quality ]
+
 colors = [ ( i, 1 - i, 0 ) for i in quality ]
 
 fig = plt.figure()
@@ -11,3 +11,13 @@ bool Point::operator==( const Point &other ) const
 	}
 	return std::equal( Begin(), End(), other.Begin() );
 }
+
+
+bool ConstPointView::operator==( const ConstPointView &other ) const
+{
+	if ( GetDimension() != other.GetDimension() )
+	{
+		return false;
+	}
+	return std::equal( Begin(), End(), other.Begin() );
+}
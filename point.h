@@ -2,41 +2,91 @@
 
 #pragma once
 
+#include "Core/assert.h"
 #include "Core/dynArray.h"
 
+#include <algorithm>
+#include <cstddef>
 
+
+class ConstPointView;
+
+
+// Point owns its coordinates. Coordinates of up to INLINE_CAPACITY dimensions are stored in the
+// point itself, without a heap allocation. Coordinates stored elsewhere, e.g. in a PointCloud, are
+// read through ConstPointView.
 class Point
 {
 public:
 
-	typedef o::DynArray<double> Data;
-	typedef typename Data::Iterator Iterator;
-	typedef typename Data::ConstIterator ConstIterator;
+	typedef double *Iterator;
+	typedef const double *ConstIterator;
+
+	enum : uint
+	{
+		INLINE_CAPACITY = 4,
+	};
 
 	Point()
+		: m_data( m_inline )
+		, m_dim( 0 )
 	{}
 
 	Point( uint dim )
-		: m_data( dim )
-	{}
+		: m_data( Allocate( dim ) )
+		, m_dim( dim )
+	{
+		Clear();
+	}
 
 	Point( const Point &other )
-		: m_data( other.m_data )
-	{}
+		: m_data( Allocate( other.m_dim ) )
+		, m_dim( other.m_dim )
+	{
+		std::copy( other.Begin(), other.End(), m_data );
+	}
 
+	// Copies the viewed coordinates.
+	explicit Point( const ConstPointView &view );
+
+	// Inline coordinates are copied.
 	Point( Point &&other )
-		: m_data( std::move( other.m_data) )
-	{}
+		: m_data( other.IsInline() ? m_inline : other.m_data )
+		, m_dim( other.m_dim )
+	{
+		if ( other.IsInline() )
+		{
+			std::copy( other.Begin(), other.End(), m_inline );
+		}
+		other.m_data = other.m_inline;
+		other.m_dim = 0;
+	}
+
+	~Point()
+	{
+		Release();
+	}
 
 	Point &operator=( const Point &other )
 	{
-		m_data = other.m_data;
+		if ( this != &other )
+		{
+			Assign( other );
+		}
 		return *this;
 	}
 
 	Point &operator=( Point &&other )
 	{
-		m_data = std::move( other.m_data );
+		if ( IsInline() || other.IsInline() )
+		{
+			Assign( other );
+		}
+		else
+		{
+			std::swap( m_data, other.m_data );
+			std::swap( m_dim, other.m_dim );
+		}
 		return *this;
 	}
 
@@ -47,50 +97,156 @@ public:
 
 	void Resize( uint n )
 	{
-		m_data.Resize( n );
+		if ( n == m_dim )
+		{
+			return;
+		}
+		double *data = Allocate( n );
+		const uint kept = std::min( n, m_dim );
+		if ( data != m_data )
+		{
+			std::copy( m_data, m_data + kept, data );
+			Release();
+		}
+		std::fill( data + kept, data + n, 0.0 );
+		m_data = data;
+		m_dim = n;
 	}
 
 	uint GetDimension() const
 	{
-		return m_data.GetSize();
+		return m_dim;
 	}
 
 	double &operator[]( uint index )
 	{
+		assert( index < m_dim );
 		return m_data[index];
 	}
 
 	const double &operator[]( uint index ) const
 	{
+		assert( index < m_dim );
 		return m_data[index];
 	}
 
 	Iterator Begin()
 	{
-		return m_data.Begin();
+		return m_data;
 	}
 
 	Iterator End()
 	{
-		return m_data.End();
+		return m_data + m_dim;
 	}
 
 	ConstIterator Begin() const
 	{
-		return m_data.Begin();
+		return m_data;
 	}
 
 	ConstIterator End() const
 	{
-		return m_data.End();
+		return m_data + m_dim;
 	}
 
 	bool operator==( const Point &other ) const;
 
+	// Inline coordinates do not take any memory besides the object itself.
+	size_t GetMemoryFootprint() const
+	{
+		return sizeof( Point ) + ( IsInline() ? 0 : m_dim * sizeof( double ) );
+	}
+
 private:
 
-	Data m_data;
+	bool IsInline() const
+	{
+		return m_data == m_inline;
+	}
+
+	double *Allocate( uint dim )
+	{
+		return dim <= INLINE_CAPACITY ? m_inline : new double[dim];
+	}
+
+	void Assign( const Point &other )
+	{
+		if ( m_dim != other.m_dim )
+		{
+			Release();
+			m_data = Allocate( other.m_dim );
+			m_dim = other.m_dim;
+		}
+		std::copy( other.Begin(), other.End(), m_data );
+	}
+
+	void Release()
+	{
+		if ( !IsInline() )
+		{
+			delete[] m_data;
+		}
+	}
+
+	double *m_data;
+	uint m_dim;
+	double m_inline[INLINE_CAPACITY];
 };
 
+////////////////////////////////////////////////////////////////////////////////
 
-typedef o::DynArray<Point> PointsList;
\ No newline at end of file
+// Read only view of coordinates stored elsewhere, e.g. in a Point or a PointCloud. The coordinates
+// have to outlive the view, views of a cloud are valid until the cloud is changed.
+class ConstPointView
+{
+public:
+
+	typedef const double *ConstIterator;
+
+	ConstPointView( const double *data, uint dim )
+		: m_data( data )
+		, m_dim( dim )
+	{}
+
+	ConstPointView( const Point &p )
+		: m_data( p.Begin() )
+		, m_dim( p.GetDimension() )
+	{}
+
+	uint GetDimension() const
+	{
+		return m_dim;
+	}
+
+	const double &operator[]( uint index ) const
+	{
+		assert( index < m_dim );
+		return m_data[index];
+	}
+
+	ConstIterator Begin() const
+	{
+		return m_data;
+	}
+
+	ConstIterator End() const
+	{
+		return m_data + m_dim;
+	}
+
+	bool operator==( const ConstPointView &other ) const;
+
+private:
+
+	const double *m_data;
+	uint m_dim;
+};
+
+
+inline Point::Point( const ConstPointView &view )
+	: m_data( Allocate( view.GetDimension() ) )
+	, m_dim( view.GetDimension() )
+{
+	std::copy( view.Begin(), view.End(), m_data );
+}
@@ -0,0 +1,185 @@
+// pbrendel (c) 2021
+
+#include "pointCloud.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+PointCloud::Precision PointCloud::s_defaultPrecision = PointCloud::Precision::Double;
+
+
+void PointCloud::Reset( uint dim, uint count )
+{
+    if ( dim != m_dim )
+    {
+        m_boundsMin.Clear();
+        m_steps.Clear();
+    }
+    m_dim = dim;
+    m_count = count;
+    m_clampedCount = 0;
+    m_coords.Clear();
+    m_singleCoords.Clear();
+    m_fixed16Coords.Clear();
+    m_fixed32Coords.Clear();
+    switch ( m_precision )
+    {
+    case Precision::Double:
+        m_coords.Resize( dim * count );
+        std::fill( m_coords.Begin(), m_coords.End(), 0.0 );
+        break;
+    case Precision::Single:
+        m_singleCoords.Resize( dim * count );
+        std::fill( m_singleCoords.Begin(), m_singleCoords.End(), 0.0f );
+        break;
+    case Precision::Fixed16:
+        m_fixed16Coords.Resize( dim * count );
+        std::fill( m_fixed16Coords.Begin(), m_fixed16Coords.End(), uint16_t( 0 ) );
+        break;
+    case Precision::Fixed32:
+        m_fixed32Coords.Resize( dim * count );
+        std::fill( m_fixed32Coords.Begin(), m_fixed32Coords.End(), uint32_t( 0 ) );
+        break;
+    }
+}
+
+
+void PointCloud::SetBounds( const Cube &bounds )
+{
+    assert( bounds.GetDimension() == m_dim );
+    const double maxValue = m_precision == Precision::Fixed16 ? std::numeric_limits<uint16_t>::max() : std::numeric_limits<uint32_t>::max();
+    m_boundsMin.Resize( m_dim );
+    m_steps.Resize( m_dim );
+    for ( uint d = 0; d < m_dim; ++d )
+    {
+        m_boundsMin[d] = bounds[d].m_min;
+        m_steps[d] = bounds[d].GetLength() / maxValue;
+    }
+}
+
+
+double PointCloud::GetCoordinateErrorBound() const
+{
+    if ( !IsQuantized() || m_steps.IsEmpty() )
+    {
+        return 0.0;
+    }
+    return *std::max_element( m_steps.Begin(), m_steps.End() ) * 0.5;
+}
+
+
+// Each of the two points moves by at most half of the step in every dimension.
+double PointCloud::GetEuclideanErrorBound() const
+{
+    double sum = 0.0;
+    if ( IsQuantized() )
+    {
+        for ( uint d = 0; d < m_steps.GetSize(); ++d )
+        {
+            sum += m_steps[d] * m_steps[d];
+        }
+    }
+    return std::sqrt( sum );
+}
+
+
+void PointCloud::PushBack( const Point &p )
+{
+    if ( m_count == 0 )
+    {
+        m_dim = p.GetDimension();
+    }
+    assert( p.GetDimension() == m_dim );
+    for ( uint d = 0; d < m_dim; ++d )
+    {
+        switch ( m_precision )
+        {
+        case Precision::Double: m_coords.PushBack( p[d] ); break;
+        case Precision::Single: m_singleCoords.PushBack( static_cast<float>( p[d] ) ); break;
+        case Precision::Fixed16: m_fixed16Coords.PushBack( Quantize<uint16_t>( d, p[d] ) ); break;
+        case Precision::Fixed32: m_fixed32Coords.PushBack( Quantize<uint32_t>( d, p[d] ) ); break;
+        }
+    }
+    m_count++;
+}
+
+
+void PointCloud::Gather( const PointCloud &other, const uint *indices, uint count )
+{
+    assert( &other != this );
+    m_precision = other.m_precision;
+    Reset( other.m_dim, count );
+    m_boundsMin = other.m_boundsMin;
+    m_steps = other.m_steps;
+    for ( uint i = 0; i < count; ++i )
+    {
+        assert( indices[i] < other.m_count );
+        const uint src = indices[i] * m_dim;
+        const uint dst = i * m_dim;
+        switch ( m_precision )
+        {
+        case Precision::Double: std::copy( &other.m_coords[src], &other.m_coords[src] + m_dim, &m_coords[dst] ); break;
+        case Precision::Single: std::copy( &other.m_singleCoords[src], &other.m_singleCoords[src] + m_dim, &m_singleCoords[dst] ); break;
+        case Precision::Fixed16: std::copy( &other.m_fixed16Coords[src], &other.m_fixed16Coords[src] + m_dim, &m_fixed16Coords[dst] ); break;
+        case Precision::Fixed32: std::copy( &other.m_fixed32Coords[src], &other.m_fixed32Coords[src] + m_dim, &m_fixed32Coords[dst] ); break;
+        }
+    }
+}
+
+
+void PointCloud::Set( uint index, const Point &p )
+{
+    assert( index < m_count );
+    assert( p.GetDimension() == m_dim );
+    for ( uint d = 0; d < m_dim; ++d )
+    {
+        SetValue( index, d, p[d] );
+    }
+}
+
+
+void PointCloud::GetValue( uint index, Point &p ) const
+{
+    assert( index < m_count && p.GetDimension() == m_dim );
+    const uint offset = index * m_dim;
+    for ( uint d = 0; d < m_dim; ++d )
+    {
+        switch ( m_precision )
+        {
+        case Precision::Double: p[d] = m_coords[offset + d]; break;
+        case Precision::Single: p[d] = m_singleCoords[offset + d]; break;
+        case Precision::Fixed16: p[d] = m_boundsMin[d] + m_fixed16Coords[offset + d] * m_steps[d]; break;
+        case Precision::Fixed32: p[d] = m_boundsMin[d] + m_fixed32Coords[offset + d] * m_steps[d]; break;
+        }
+    }
+}
+
+
+void PointCloud::SetValue( uint index, uint d, double value )
+{
+    const uint offset = index * m_dim + d;
+    switch ( m_precision )
+    {
+    case Precision::Double: m_coords[offset] = value; break;
+    case Precision::Single: m_singleCoords[offset] = static_cast<float>( value ); break;
+    case Precision::Fixed16: m_fixed16Coords[offset] = Quantize<uint16_t>( d, value ); break;
+    case Precision::Fixed32: m_fixed32Coords[offset] = Quantize<uint32_t>( d, value ); break;
+    }
+}
+
+
+template <class T>
+T PointCloud::Quantize( uint d, double value )
+{
+    assertex( m_steps.GetSize() == m_dim, "Bounds of a quantized cloud are not set" );
+    const double maxValue = std::numeric_limits<T>::max();
+    const double q = m_steps[d] > 0.0 ? std::round( ( value - m_boundsMin[d] ) / m_steps[d] ) : 0.0;
+    if ( q < 0.0 || q > maxValue )
+    {
+        m_clampedCount++;
+        return q < 0.0 ? T( 0 ) : std::numeric_limits<T>::max();
+    }
+    return static_cast<T>( q );
+}
@@ -0,0 +1,276 @@
+// pbrendel (c) 2021
+
+#pragma once
+
+#include "cube.h"
+#include "point.h"
+#include "Core/dynArray.h"
+
+#include <cstddef>
+#include <cstdint>
+
+
+// Points of the same dimension stored contiguously, one point after another. Coordinates are
+// stored as doubles or, in single precision clouds, as floats. Points of a double precision
+// cloud are read in place through views, which stay valid until the cloud is changed, points of
+// any cloud can be copied out with GetValue. Distances are always computed in double.
+class PointCloud
+{
+public:
+
+    // Fixed16 and Fixed32 clouds store the coordinates as fixed point offsets within the bounds
+    // of the cloud, which have to be set with SetBounds before any point is added.
+    enum class Precision : uint
+    {
+        Double,
+        Single,
+        Fixed16,
+        Fixed32,
+    };
+
+    // Precision of the clouds created later on, the clouds that have to reproduce exact
+    // coordinates, e.g. for point lookups, ask for double precision explicitly.
+    static void SetDefaultPrecision( Precision precision )
+    {
+        s_defaultPrecision = precision;
+    }
+
+    static Precision GetDefaultPrecision()
+    {
+        return s_defaultPrecision;
+    }
+
+    explicit PointCloud( Precision precision = GetDefaultPrecision() )
+        : m_dim( 0 )
+        , m_count( 0 )
+        , m_precision( precision )
+        , m_clampedCount( 0 )
+    {}
+
+    PointCloud( uint dim, uint count, Precision precision = GetDefaultPrecision() )
+        : m_dim( 0 )
+        , m_precision( precision )
+    {
+        Reset( dim, count );
+    }
+
+    // Sets dimension and count, all the coordinates are zeroed. Precision is kept and so are the
+    // bounds if the dimension does not change.
+    void Reset( uint dim, uint count );
+
+    // Removes all the points, the dimension is kept.
+    void Clear()
+    {
+        m_coords.Clear();
+        m_singleCoords.Clear();
+        m_fixed16Coords.Clear();
+        m_fixed32Coords.Clear();
+        m_count = 0;
+    }
+
+    // Bounds of the quantized coordinates, coordinates outside of the bounds are clamped. Clouds
+    // of other precisions ignore the bounds.
+    void SetBounds( const Cube &bounds );
+
+    // Dimension of an empty cloud is taken from the first point added.
+    void PushBack( const Point &p );
+
+    void Set( uint index, const Point &p );
+
+    // Resets the cloud to the points of the other cloud with the given indices, in that order.
+    // The precision of the other cloud is taken, so the coordinates are copied exactly.
+    void Gather( const PointCloud &other, const uint *indices, uint count );
+
+    void Gather( const PointCloud &other, const o::DynArray<uint> &indices )
+    {
+        Gather( other, indices.IsEmpty() ? nullptr : &indices[0], indices.GetSize() );
+    }
+
+    uint GetDimension() const
+    {
+        return m_dim;
+    }
+
+    uint GetSize() const
+    {
+        return m_count;
+    }
+
+    bool IsEmpty() const
+    {
+        return m_count == 0;
+    }
+
+    Precision GetPrecision() const
+    {
+        return m_precision;
+    }
+
+    bool IsSinglePrecision() const
+    {
+        return m_precision == Precision::Single;
+    }
+
+    bool IsQuantized() const
+    {
+        return m_precision == Precision::Fixed16 || m_precision == Precision::Fixed32;
+    }
+
+    // Coordinate d of a quantized point is GetBoundsMin()[d] + q * GetQuantizationSteps()[d].
+    const double *GetBoundsMin() const
+    {
+        assert( IsQuantized() && m_boundsMin.GetSize() == m_dim );
+        return &m_boundsMin[0];
+    }
+
+    const double *GetQuantizationSteps() const
+    {
+        assert( IsQuantized() && m_steps.GetSize() == m_dim );
+        return &m_steps[0];
+    }
+
+    // Largest difference between a coordinate and its stored value, 0 if not quantized.
+    double GetCoordinateErrorBound() const;
+    // Largest difference between the euclidean distance of two points and of their stored values.
+    double GetEuclideanErrorBound() const;
+
+    // Number of coordinates clamped to the bounds, the error bounds do not hold for these.
+    uint GetClampedCount() const
+    {
+        return m_clampedCount;
+    }
+
+    // Only double precision clouds store the coordinates as doubles, other clouds are read with GetValue.
+    ConstPointView operator[]( uint index ) const
+    {
+        assert( m_precision == Precision::Double && index < m_count );
+        return ConstPointView( &m_coords[index * m_dim], m_dim );
+    }
+
+    // Coordinates converted to double, in clouds of any precision.
+    void GetValue( uint index, Point &p ) const;
+
+    // Coordinates in the storage type: double, float, uint16_t or uint32_t depending on the precision of the cloud.
+    template <class T>
+    const T *GetCoords( uint index ) const;
+
+    size_t GetMemoryFootprint() const
+    {
+        return sizeof( PointCloud ) + m_coords.GetSize() * sizeof( double ) + m_singleCoords.GetSize() * sizeof( float )
+               + m_fixed16Coords.GetSize() * sizeof( uint16_t ) + m_fixed32Coords.GetSize() * sizeof( uint32_t );
+    }
+
+private:
+
+    void SetValue( uint index, uint d, double value );
+    template <class T>
+    T Quantize( uint d, double value );
+
+    o::DynArray<double> m_coords;
+    o::DynArray<float> m_singleCoords;
+    o::DynArray<uint16_t> m_fixed16Coords;
+    o::DynArray<uint32_t> m_fixed32Coords;
+    o::DynArray<double> m_boundsMin;
+    o::DynArray<double> m_steps;
+    uint m_dim;
+    uint m_count;
+    Precision m_precision;
+    uint m_clampedCount;
+
+    static Precision s_defaultPrecision;
+};
+
+
+template <>
+inline const double *PointCloud::GetCoords<double>( uint index ) const
+{
+    assert( m_precision == Precision::Double && index < m_count );
+    return &m_coords[index * m_dim];
+}
+
+
+template <>
+inline const float *PointCloud::GetCoords<float>( uint index ) const
+{
+    assert( IsSinglePrecision() && index < m_count );
+    return &m_singleCoords[index * m_dim];
+}
+
+
+template <>
+inline const uint16_t *PointCloud::GetCoords<uint16_t>( uint index ) const
+{
+    assert( m_precision == Precision::Fixed16 && index < m_count );
+    return &m_fixed16Coords[index * m_dim];
+}
+
+
+template <>
+inline const uint32_t *PointCloud::GetCoords<uint32_t>( uint index ) const
+{
+    assert( m_precision == Precision::Fixed32 && index < m_count );
+    return &m_fixed32Coords[index * m_dim];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Graph of a map over a cloud. Graph point i is the concatenation of domain point i and range point i,
+// the coordinates are not copied and both clouds have to outlive the graph.
+class GraphPointCloud
+{
+public:
+
+    GraphPointCloud()
+        : m_domainPoints( nullptr )
+        , m_rangePoints( nullptr )
+    {}
+
+    GraphPointCloud( const PointCloud &domainPoints, const PointCloud &rangePoints )
+        : m_domainPoints( &domainPoints )
+        , m_rangePoints( &rangePoints )
+    {
+        assert( domainPoints.GetSize() == rangePoints.GetSize() );
+    }
+
+    uint GetDimension() const
+    {
+        return GetDomainDimension() + GetRangeDimension();
+    }
+
+    uint GetDomainDimension() const
+    {
+        return m_domainPoints != nullptr ? m_domainPoints->GetDimension() : 0;
+    }
+
+    uint GetRangeDimension() const
+    {
+        return m_rangePoints != nullptr ? m_rangePoints->GetDimension() : 0;
+    }
+
+    uint GetSize() const
+    {
+        return m_domainPoints != nullptr ? m_domainPoints->GetSize() : 0;
+    }
+
+    bool IsEmpty() const
+    {
+        return GetSize() == 0;
+    }
+
+    const PointCloud &GetDomainPoints() const
+    {
+        assert( m_domainPoints != nullptr );
+        return *m_domainPoints;
+    }
+
+    const PointCloud &GetRangePoints() const
+    {
+        assert( m_rangePoints != nullptr );
+        return *m_rangePoints;
+    }
+
+private:
+
+    const PointCloud *m_domainPoints;
+    const PointCloud *m_rangePoints;
+};
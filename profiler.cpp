@@ -0,0 +1,131 @@
+// pbrendel (c) 2021
+
+#include "profiler.h"
+#include "Core/assert.h"
+
+#include <cstring>
+#include <iomanip>
+
+
+Profiler &Profiler::Get()
+{
+    static Profiler s_instance;
+    return s_instance;
+}
+
+
+Profiler::Profiler()
+{
+    Reset();
+}
+
+
+void Profiler::Begin( const char *name )
+{
+    m_current = FindChild( m_current, name );
+}
+
+
+void Profiler::End( double time, const AllocationTracker::Counters &allocations )
+{
+    assertex( m_current != 0, "Profiler::End without matching Begin" );
+    Node &node = m_nodes[m_current];
+    node.m_time += time;
+    node.m_calls++;
+    node.m_allocations += allocations.m_allocations;
+    node.m_allocatedBytes += allocations.m_bytes;
+    m_current = node.m_parent;
+}
+
+
+void Profiler::Reset()
+{
+    assertex( m_nodes.IsEmpty() || m_current == 0, "Profiler::Reset inside a scope" );
+    m_nodes.Clear();
+    m_nodes.PushBack( Node( "total", 0 ) );
+    m_current = 0;
+}
+
+
+void Profiler::Print( std::ostream &str ) const
+{
+    str << std::left << std::setw( 56 ) << "phase" << std::right
+        << std::setw( 12 ) << "calls"
+        << std::setw( 14 ) << "total s"
+        << std::setw( 14 ) << "avg ms"
+        << std::setw( 10 ) << "parent %";
+    if ( AllocationTracker::IsEnabled() )
+    {
+        str << std::setw( 14 ) << "allocs/call" << std::setw( 14 ) << "KB/call";
+    }
+    str << std::endl;
+    const Node &root = m_nodes[0];
+    for ( o::DynArray<uint>::ConstIterator child = root.m_children.Begin(); child != root.m_children.End(); ++child )
+    {
+        PrintNode( str, *child, 0 );
+    }
+}
+
+
+std::string Profiler::GetPath( uint index ) const
+{
+    if ( index == 0 )
+    {
+        return m_nodes[0].m_name;
+    }
+    std::string path = m_nodes[index].m_name;
+    index = m_nodes[index].m_parent;
+    while ( index != 0 )
+    {
+        path = std::string( m_nodes[index].m_name ) + "/" + path;
+        index = m_nodes[index].m_parent;
+    }
+    return path;
+}
+
+
+uint Profiler::FindChild( uint parent, const char *name )
+{
+    const o::DynArray<uint> &children = m_nodes[parent].m_children;
+    for ( o::DynArray<uint>::ConstIterator child = children.Begin(); child != children.End(); ++child )
+    {
+        const char *childName = m_nodes[*child].m_name;
+        if ( childName == name || strcmp( childName, name ) == 0 )
+        {
+            return *child;
+        }
+    }
+    const uint index = m_nodes.GetSize();
+    m_nodes.PushBack( Node( name, parent ) );
+    m_nodes[parent].m_children.PushBack( index );
+    return index;
+}
+
+
+void Profiler::PrintNode( std::ostream &str, uint index, uint depth ) const
+{
+    const Node &node = m_nodes[index];
+    const Node &parent = m_nodes[node.m_parent];
+    const std::string name = std::string( depth * 2, ' ' ) + node.m_name;
+    const std::streamsize precision = str.precision();
+    str << std::left << std::setw( 56 ) << name << std::right
+        << std::setw( 12 ) << node.m_calls
+        << std::fixed << std::setprecision( 3 )
+        << std::setw( 14 ) << node.m_time
+        << std::setw( 14 ) << ( node.m_calls > 0 ? node.m_time * 1e3 / node.m_calls : 0.0 )
+        << std::setprecision( 1 )
+        << std::setw( 10 ) << ( parent.m_time > 0.0 ? node.m_time * 100.0 / parent.m_time : 100.0 );
+    if ( AllocationTracker::IsEnabled() )
+    {
+        const double calls = node.m_calls > 0 ? static_cast<double>( node.m_calls ) : 1.0;
+        str << std::setw( 14 ) << node.m_allocations / calls
+            << std::setw( 14 ) << node.m_allocatedBytes / calls / 1024.0;
+    }
+    str << std::endl;
+    str.unsetf( std::ios_base::floatfield );
+    str.precision( precision );
+    for ( o::DynArray<uint>::ConstIterator child = node.m_children.Begin(); child != node.m_children.End(); ++child )
+    {
+        PrintNode( str, *child, depth + 1 );
+    }
+}
@@ -0,0 +1,94 @@
+// pbrendel (c) 2021
+
+#pragma once
+
+#include "allocationTracker.h"
+#include "Core/dynArray.h"
+#include "Core/perfCounter.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+
+// Accumulates time and call counts of nested phases. Phases are identified by their names
+// and by the chain of phases they were entered from, so the same name in two different
+// contexts gives two separate entries in the tree.
+class Profiler
+{
+public:
+
+    static Profiler &Get();
+
+    void Begin( const char *name );
+    void End( double time, const AllocationTracker::Counters &allocations );
+    void Reset();
+    void Print( std::ostream &str ) const;
+
+    // Index of the innermost active phase, 0 outside any phase.
+    uint GetCurrent() const
+    {
+        return m_current;
+    }
+
+    std::string GetPath( uint index ) const;
+
+private:
+
+    struct Node
+    {
+        const char *m_name;
+        uint m_parent;
+        o::DynArray<uint> m_children;
+        double m_time;
+        uint64_t m_calls;
+        uint64_t m_allocations;
+        uint64_t m_allocatedBytes;
+
+        Node( const char *name, uint parent )
+            : m_name( name )
+            , m_parent( parent )
+            , m_time( 0.0 )
+            , m_calls( 0 )
+            , m_allocations( 0 )
+            , m_allocatedBytes( 0 )
+        {}
+    };
+
+    Profiler();
+
+    uint FindChild( uint parent, const char *name );
+    void PrintNode( std::ostream &str, uint index, uint depth ) const;
+
+    o::DynArray<Node> m_nodes;
+    uint m_current;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class ProfileScope
+{
+public:
+
+    // Name has to outlive the profiler entry, string literals are expected here.
+    ProfileScope( const char *name )
+    {
+        Profiler::Get().Begin( name );
+        m_allocations = AllocationTracker::GetCounters();
+        m_perfCounter.Reset();
+    }
+
+    ~ProfileScope()
+    {
+        const double time = m_perfCounter.Reset();
+        const AllocationTracker::Counters allocations = AllocationTracker::GetCounters();
+        m_allocations.m_allocations = allocations.m_allocations - m_allocations.m_allocations;
+        m_allocations.m_bytes = allocations.m_bytes - m_allocations.m_bytes;
+        Profiler::Get().End( time, m_allocations );
+    }
+
+private:
+
+    PerfCounter m_perfCounter;
+    AllocationTracker::Counters m_allocations;
+};
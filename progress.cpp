@@ -0,0 +1,91 @@
+// pbrendel (c) 2021
+
+#include "progress.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+
+Progress &Progress::Get()
+{
+    static Progress progress;
+    return progress;
+}
+
+
+Progress::Progress()
+    : m_enabled( false )
+    , m_interval( 1.0 )
+{
+}
+
+
+void Progress::Enable( double interval, const std::string &statusFilename )
+{
+    m_enabled = true;
+    m_interval = interval;
+    m_statusFilename = statusFilename;
+}
+
+
+void Progress::Disable()
+{
+    m_enabled = false;
+}
+
+
+void Progress::Write( const std::string &line ) const
+{
+    if ( m_statusFilename.empty() )
+    {
+        std::cerr << line << std::endl;
+        return;
+    }
+    std::ofstream file( m_statusFilename.c_str(), std::ios_base::trunc );
+    file << line << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ProgressReporter::ProgressReporter( const char *name, uint total )
+    : m_name( name )
+    , m_total( total )
+    , m_done( 0 )
+    , m_restrictionPointsCount( 0 )
+    , m_enabled( Progress::Get().IsEnabled() )
+{
+    if ( m_enabled )
+    {
+        m_start = std::chrono::steady_clock::now();
+        m_nextReport = m_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( Progress::Get().GetInterval() ) );
+    }
+}
+
+
+ProgressReporter::~ProgressReporter()
+{
+    if ( m_enabled )
+    {
+        Report();
+    }
+}
+
+
+void ProgressReporter::Report()
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    const double elapsed = std::chrono::duration<double>( now - m_start ).count();
+    const double rate = elapsed > 0.0 ? m_done / elapsed : 0.0;
+    const double eta = rate > 0.0 ? ( m_total - m_done ) / rate : 0.0;
+    std::ostringstream line;
+    line << std::fixed << m_name << ": " << m_done << "/" << m_total
+         << " (" << std::setprecision( 1 ) << ( m_total > 0 ? m_done * 100.0 / m_total : 100.0 ) << "%)"
+         << ", " << rate << " centers/s"
+         << ", mean restriction " << ( m_done > 0 ? static_cast<double>( m_restrictionPointsCount ) / m_done : 0.0 )
+         << ", elapsed " << elapsed << " s"
+         << ", eta " << eta << " s";
+    Progress::Get().Write( line.str() );
+    m_nextReport = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( Progress::Get().GetInterval() ) );
+}
@@ -0,0 +1,77 @@
+// pbrendel (c) 2021
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+
+// Periodically reports how far the main loops of the algorithms are. Reports go to stderr,
+// or replace the contents of the status file so it always holds the latest state.
+class Progress
+{
+public:
+
+    static Progress &Get();
+
+    void Enable( double interval, const std::string &statusFilename );
+    void Disable();
+
+    bool IsEnabled() const
+    {
+        return m_enabled;
+    }
+
+    double GetInterval() const
+    {
+        return m_interval;
+    }
+
+    void Write( const std::string &line ) const;
+
+private:
+
+    Progress();
+
+    bool m_enabled;
+    double m_interval;
+    std::string m_statusFilename;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class ProgressReporter
+{
+public:
+
+    // Name has to outlive the reporter, string literals are expected here.
+    ProgressReporter( const char *name, uint total );
+    ~ProgressReporter();
+
+    // Costs a single flag check when progress reporting is disabled.
+    void Step( uint restrictionSize )
+    {
+        if ( m_enabled )
+        {
+            m_done++;
+            m_restrictionPointsCount += restrictionSize;
+            if ( std::chrono::steady_clock::now() >= m_nextReport )
+            {
+                Report();
+            }
+        }
+    }
+
+private:
+
+    void Report();
+
+    const char *m_name;
+    uint m_total;
+    uint m_done;
+    uint64_t m_restrictionPointsCount;
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::steady_clock::time_point m_nextReport;
+    bool m_enabled;
+};
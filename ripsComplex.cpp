@@ -1,73 +1,190 @@
 // pbrendel (c) 2013-21
 
 #include "ripsComplex.h"
+#include "fixedDistance.h"
+#include "hardwareCounters.h"
 #include "metrics.h"
-#include "Core/deque.h"
-#include "Core/dynBuffer.h"
+#include "profiler.h"
+#include "trace.h"
 
 #include <algorithm>
 
 using o::DynArray;
 
 
-RipsComplex::RipsComplex( const PointsList &points, const Metrics &metrics, double epsilon, bool gluePoints )
+struct RipsComplex::CreateVisitor
+{
+    RipsComplex &m_rips;
+    double m_epsilon;
+    bool m_gluePoints;
+
+    template <class Distance>
+    void Visit( const Distance &distance )
+    {
+        m_rips.Create( distance, m_epsilon, m_gluePoints );
+    }
+};
+
+
+struct RipsComplex::CalculateVertexReferenceDistanceVisitor
+{
+    RipsComplex &m_rips;
+    ArenaBuffer<VertexRefDist> &m_vertsRefDist;
+
+    template <class Distance>
+    void Visit( const Distance &distance )
+    {
+        m_rips.CalculateVertexReferenceDistance( distance, m_vertsRefDist );
+    }
+};
+
+
+struct RipsComplex::CreateEdgesVisitor
+{
+    RipsComplex &m_rips;
+    const ArenaBuffer<VertexRefDist> &m_vertsRefDist;
+    double m_epsilon;
+
+    template <class Distance>
+    void Visit( const Distance &distance )
+    {
+        m_rips.CreateEdges( m_vertsRefDist, distance, m_epsilon );
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+RipsComplex::RipsComplex( const PointCloud &points, const Metrics &metrics, double epsilon, bool gluePoints )
+    : RipsComplex()
+{
+    Create( points, metrics, epsilon, gluePoints );
+}
+
+
+RipsComplex::RipsComplex( const GraphPointCloud &points, const Metrics &metrics, double epsilon, bool gluePoints )
+    : RipsComplex()
 {
     Create( points, metrics, epsilon, gluePoints );
 }
 
 
-void RipsComplex::Create( const PointsList &points, const Metrics &metrics, double epsilon, bool gluePoints )
+void RipsComplex::Create( const PointCloud &points, const Metrics &metrics, double epsilon, bool gluePoints )
+{
+    ProfileScope scope( "RipsComplex::Create" );
+    TraceScope trace( "Rips" );
+    assert( !gluePoints || !metrics.IsIndexMetrics() );
+    CreateVerts( points );
+    CreateVisitor visitor = { *this, epsilon, gluePoints };
+    DispatchDistance( points, metrics, visitor );
+    trace.AddArg( "points", m_vertsCount );
+    trace.AddArg( "edges", m_edges.GetSize() );
+}
+
+
+void RipsComplex::Create( const GraphPointCloud &points, const Metrics &metrics, double epsilon, bool gluePoints )
 {
+    ProfileScope scope( "RipsComplex::Create" );
+    TraceScope trace( "Rips" );
+    assert( !gluePoints || !metrics.IsIndexMetrics() );
     CreateVerts( points );
+    CreateVisitor visitor = { *this, epsilon, gluePoints };
+    DispatchDistance( points, metrics, visitor );
+    trace.AddArg( "points", m_vertsCount );
+    trace.AddArg( "edges", m_edges.GetSize() );
+}
+
+
+template <class Distance>
+void RipsComplex::Create( const Distance &distance, double epsilon, bool gluePoints )
+{
     if ( gluePoints )
     {
-        GluePoints( metrics );
+        GluePoints( distance );
     }
     AssignLabels();
-    CreateEdges( metrics, epsilon );
+    ArenaBuffer<VertexRefDist> vertsRefDist( m_vertsCount );
+    CalculateVertexReferenceDistance( distance, vertsRefDist );
+    CreateEdges( vertsRefDist, distance, epsilon );
     m_ccRepresentative.Clear();
 }
 
 
-void RipsComplex::CreateVerts( const PointsList &points )
+void RipsComplex::CreateVerts( const PointCloud &points )
 {
-    m_vertsCount = points.GetSize();
+    m_points = &points;
+    m_rangePoints = nullptr;
+    CreateVerts( points.GetSize() );
+}
+
+
+void RipsComplex::CreateVerts( const GraphPointCloud &points )
+{
+    m_points = &points.GetDomainPoints();
+    m_rangePoints = &points.GetRangePoints();
+    CreateVerts( points.GetSize() );
+}
+
+
+void RipsComplex::CreateVerts( uint count )
+{
+    ProfileScope scope( "RipsComplex::CreateVerts" );
+    m_vertsCount = count;
     m_verts.Reset( m_vertsCount );
     for ( uint i = 0; i < m_vertsCount; ++i )
     {
-        m_verts[i].m_point = &points[i];
+        m_verts[i] = Vertex();
+        m_verts[i].m_pointIndex = i;
     }
+    m_vertsFootprint.Update( m_vertsCount * sizeof( Vertex ) );
+}
+
+
+void RipsComplex::CalculateVertexReferenceDistance( const Metrics &metrics, ArenaBuffer<VertexRefDist> &outVertsRefDist )
+{
+    assert( m_rangePoints == nullptr );
+    outVertsRefDist.Reset( m_vertsCount );
+    CalculateVertexReferenceDistanceVisitor visitor = { *this, outVertsRefDist };
+    DispatchDistance( *m_points, metrics, visitor );
 }
 
 
-o::DynBuffer<RipsComplex::VertexRefDist> RipsComplex::CalculateVertexReferenceDistance( const Metrics &metrics )
+template <class Distance>
+void RipsComplex::CalculateVertexReferenceDistance( const Distance &distance, ArenaBuffer<VertexRefDist> &outVertsRefDist )
 {
     struct VertexRefDistComparer
     {
         bool operator()( const VertexRefDist &a, const VertexRefDist &b ) { return a.m_distance < b.m_distance; }
     };
 
-    o::DynBuffer<VertexRefDist> vertRefDist( m_vertsCount );
+    ProfileScope scope( "RipsComplex::CalculateVertexReferenceDistance" );
+    assert( outVertsRefDist.GetSize() >= m_vertsCount );
+    VertexRefDist *vertRefDist = outVertsRefDist.Get();
     const Vertex *verts = m_verts.Get();
-    const Point *center = verts[0].m_point;
-    vertRefDist[0].m_index = 0;
-    vertRefDist[0].m_distance = 0.0;
-    for ( uint i = 1; i < m_vertsCount; ++i )
+    const typename Distance::PointType center = distance.Load( verts[0].m_pointIndex );
+    ArenaBuffer<uint> pointIndices( m_vertsCount );
+    ArenaBuffer<double> distances( m_vertsCount );
+    for ( uint i = 0; i < m_vertsCount; ++i )
+    {
+        pointIndices[i] = verts[i].m_pointIndex;
+    }
+    distances[0] = 0.0;
+    distance.GetDistances( center, pointIndices[0], pointIndices.Get() + 1, m_vertsCount - 1, distances.Get() + 1 );
+    for ( uint i = 0; i < m_vertsCount; ++i )
     {
-        const double d = metrics.GetDistance( *center, *verts[i].m_point, 0, i );
         vertRefDist[i].m_index = i;
-        vertRefDist[i].m_distance = d;
+        vertRefDist[i].m_distance = distances[i];
     }
-    std::sort( vertRefDist.Get(), vertRefDist.Get() + m_vertsCount, VertexRefDistComparer() );
-    return vertRefDist;
+    std::sort( vertRefDist, vertRefDist + m_vertsCount, VertexRefDistComparer() );
 }
 
 
-void RipsComplex::GluePoints( const Metrics &metrics )
+template <class Distance>
+void RipsComplex::GluePoints( const Distance &distance )
 {
-    assert( !metrics.IsIndexMetrics() );
+    ProfileScope scope( "RipsComplex::GluePoints" );
     
-    o::DynBuffer<VertexRefDist> vertsRefDist = CalculateVertexReferenceDistance( metrics );
+    ArenaBuffer<VertexRefDist> vertsRefDist( m_vertsCount );
+    CalculateVertexReferenceDistance( distance, vertsRefDist );
 
     constexpr Label LABEL_REMOVED = O_INVALID_INDEX - 1;
     struct LabelRemove
@@ -95,10 +212,11 @@ void RipsComplex::GluePoints( const Metrics &metrics )
                 {
                     continue;
                 }
+                const typename Distance::PointType pointI = distance.Load( v.m_pointIndex );
                 for ( uint j = i + 1; j < end; ++j )
                 {
                     const uint indexJ = vertsRefDist[j].m_index;
-                    if ( metrics.GetDistance( *v.m_point, *m_verts[indexJ].m_point, indexI, indexJ ) == 0 )
+                    if ( distance.WithinDistance( pointI, distance.Load( m_verts[indexJ].m_pointIndex ), indexI, indexJ, 0.0 ) )
                     {
                         m_verts[indexJ].m_label = LABEL_REMOVED;
                     }
@@ -124,43 +242,75 @@ void RipsComplex::AssignLabels()
 }
 
 
-void RipsComplex::CreateEdges( const Metrics &metrics, double epsilon )
+void RipsComplex::CreateEdges( const ArenaBuffer<VertexRefDist> &vertsRefDist, const Metrics &metrics, double epsilon )
 {
-    o::DynBuffer<VertexRefDist> vertsRefDist = CalculateVertexReferenceDistance( metrics );
-    
+    assert( m_rangePoints == nullptr );
+    CreateEdgesVisitor visitor = { *this, vertsRefDist, epsilon };
+    DispatchDistance( *m_points, metrics, visitor );
+}
+
+
+template <class Distance>
+void RipsComplex::CreateEdges( const ArenaBuffer<VertexRefDist> &vertsRefDist, const Distance &distance, double epsilon )
+{
+    typedef typename Distance::PointType PointType;
+    ProfileScope scope( "RipsComplex::CreateEdges" );
+    HardwareCounterScope counters( "RipsComplex::CreateEdges" );
+    counters.SetItems( m_vertsCount );
+    m_statistics = RipsStatistics();
     m_vertexDegree = 0;
     m_edges.Init( 1, m_vertsCount * 4 );
-    o::DynBuffer<uint> vertDegree( m_vertsCount );
+    ArenaBuffer<uint> vertDegree( m_vertsCount );
     vertDegree.Clear();
-    o::DynBuffer<uint> firstNonChecked( m_vertsCount );
+    ArenaBuffer<uint> firstNonChecked( m_vertsCount );
     firstNonChecked.Clear();
+    // Point indices in the order of the reference distance, so the candidates of a window are contiguous.
+    ArenaBuffer<uint> pointIndices( m_vertsCount );
+    for ( uint i = 0; i < m_vertsCount; ++i )
+    {
+        pointIndices[i] = m_verts[vertsRefDist[i].m_index].m_pointIndex;
+    }
+    ArenaBuffer<uint32_t> withinMask( ( m_vertsCount + 31 ) / 32 );
 
     // Chech for connectibity within each group of distance no greater than 'epsilon'
     uint start = 0;
     while ( start < m_vertsCount )
     {
         const double d = vertsRefDist[start].m_distance;
-        uint end = (std::max)( start + 1, firstNonChecked[start] );
-        while ( end < m_vertsCount && vertsRefDist[end].m_distance == d )
+        uint endGroup = start + 1;
+        while ( endGroup < m_vertsCount && vertsRefDist[endGroup].m_distance == d )
         {
-            end++;
+            endGroup++;
         }
-        const uint endGroup = end;
+        // Every group has to start a window, as the pairs beyond the previous windows are checked only here.
+        uint end = (std::max)( endGroup, firstNonChecked[start] );
         while ( end < m_vertsCount && vertsRefDist[end].m_distance <= d + epsilon )
         {
             end++;
         }
+        m_statistics.m_windowsCount++;
+        m_statistics.m_windowSizesSum += end - start;
+        m_statistics.m_maxWindowSize = (std::max)( m_statistics.m_maxWindowSize, end - start );
         if ( end > start + 1 )
         {
             for ( uint i = start; i < end; ++i )
             {
                 const uint indexI = vertsRefDist[i].m_index;
-                const Vertex &v = m_verts[indexI];
-                for ( uint j = (std::max)( i + 1, firstNonChecked[i] ); j < end; ++j )
+                const uint firstJ = (std::max)( i + 1, firstNonChecked[i] );
+                firstNonChecked[i] = end;
+                if ( end <= firstJ )
                 {
-                    const uint indexJ = vertsRefDist[j].m_index;
-                    if ( metrics.GetDistance( *v.m_point, *m_verts[indexJ].m_point, indexI, indexJ ) <= epsilon )
+                    continue;
+                }
+                m_statistics.m_pairTestsCount += end - firstJ;
+                const PointType pointI = distance.Load( pointIndices[i] );
+                distance.GetWithinDistance( pointI, pointIndices[i], pointIndices.Get() + firstJ, end - firstJ, epsilon, withinMask.Get() );
+                for ( uint j = firstJ; j < end; ++j )
+                {
+                    const uint k = j - firstJ;
+                    if ( ( withinMask[k / 32] & ( 1u << ( k % 32 ) ) ) != 0 )
                     {
+                        const uint indexJ = vertsRefDist[j].m_index;
                         Simplex edge = m_edges.PushBack();
                         edge[0] = indexI;
                         edge[1] = indexJ;
@@ -168,16 +318,23 @@ void RipsComplex::CreateEdges( const Metrics &metrics, double epsilon )
                         m_vertexDegree = (std::max)( m_vertexDegree, ++vertDegree[indexJ] );
                     }
                 }
-                firstNonChecked[i] = end;
             }
         }
         start = endGroup;
     }
+    m_statistics.m_edgesCount = m_edges.GetSize();
+    m_statistics.m_vertexDegree = m_vertexDegree;
+    m_statistics.m_edgesBytes = m_edges.GetMemoryFootprint();
+    m_edgesFootprint.Update( m_statistics.m_edgesBytes );
 }
 
 
 void RipsComplex::CreateConnectedComponents()
 {
+    ProfileScope scope( "RipsComplex::CreateConnectedComponents" );
+    TraceScope trace( "ConnectedComponents" );
+    HardwareCounterScope counters( "RipsComplex::CreateConnectedComponents" );
+    counters.SetItems( m_vertsCount );
     m_ccRepresentative.Clear();
     for ( uint i = 0; i < m_vertsCount; ++i )
     {
@@ -185,8 +342,10 @@ void RipsComplex::CreateConnectedComponents()
     }
 
     SimplexSet neighbours( m_vertexDegree, m_vertsCount );
+    m_statistics.m_neighboursBytes = neighbours.GetMemoryFootprint();
+    const MemoryFootprintScope neighboursFootprint( MemoryFootprint::Category::RipsNeighbours, m_statistics.m_neighboursBytes );
     neighbours.Resize( m_vertsCount );
-    o::DynBuffer<uint> neighboursCount( m_vertsCount );
+    ArenaBuffer<uint> neighboursCount( m_vertsCount );
     neighboursCount.Clear();
     const uint edgesCount = m_edges.GetSize();
     for ( uint i = 0; i < edgesCount; ++i )
@@ -204,8 +363,11 @@ void RipsComplex::CreateConnectedComponents()
         }
     }
 
-    // Do a simple BFS to mark connected components.
+    // Do a simple BFS to mark connected components. Every vertex is queued once, so the queue
+    // of all the components fits in a single buffer.
     Vertex *verts = m_verts.Get();
+    ArenaBuffer<uint> queue( m_vertsCount );
+    uint queueEnd = 0;
     for ( uint i = 0; i < m_vertsCount; ++i )
     {
         if ( m_verts[i].m_ccIndex != O_INVALID_INDEX )
@@ -214,23 +376,23 @@ void RipsComplex::CreateConnectedComponents()
         }
         const uint newCcIndex = m_ccRepresentative.GetSize();
         m_ccRepresentative.PushBack( i );
-        o::Deque<uint> q;
-        q.PushBack( i );
+        uint queueBegin = queueEnd;
+        queue[queueEnd++] = i;
         verts[i].m_ccIndex = newCcIndex;
-        while ( !q.IsEmpty() )
+        while ( queueBegin < queueEnd )
         {
-            Simplex n = neighbours[q.Front()];
-            const uint count = neighboursCount[q.Front()];
+            const uint front = queue[queueBegin++];
+            Simplex n = neighbours[front];
+            const uint count = neighboursCount[front];
             for ( uint d = 0; d < count; ++d )
             {
                 const uint v = static_cast<uint>( n[d] );
                 if ( verts[v].m_ccIndex == O_INVALID_INDEX )
                 {
                     verts[v].m_ccIndex = newCcIndex;
-                    q.PushBack( v );
+                    queue[queueEnd++] = v;
                 }
             }
-            q.PopFront();
         }
     }
 }
@@ -245,6 +407,9 @@ uint RipsComplex::GetConnectedComponentsNumber() const
 
 void RipsComplex::GetProjectionMap( const RipsComplex &rangeComplex, o::Map<uint, uint> &outProjection ) const
 {
+    ProfileScope scope( "RipsComplex::GetProjectionMap" );
+    TraceScope trace( "Projection" );
+    trace.AddArg( "components", m_ccRepresentative.GetSize() );
     for ( DynArray<uint>::ConstIterator v = m_ccRepresentative.Begin(); v != m_ccRepresentative.End(); ++v )
     {
         outProjection[*v] = rangeComplex.m_ccRepresentative[rangeComplex.m_verts[*v].m_ccIndex];
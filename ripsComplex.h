@@ -2,15 +2,50 @@
 
 #pragma once
 
+#include "arena.h"
+#include "memoryFootprint.h"
 #include "simplexSet.h"
-#include "point.h"
+#include "pointCloud.h"
 #include "Core/defs.h"
 #include "Core/dynArray.h"
-#include "Core/dynBuffer.h"
 #include "Core/map.h"
 
+#include <cstdint>
+
 class Metrics;
 
+
+// Work done by the last RipsComplex::Create and CreateConnectedComponents calls. CreateEdges
+// tests all the pairs within a window of vertices with reference distances in d..d+epsilon,
+// the ratio of pair tests to edges shows how much of that work is wasted.
+struct RipsStatistics
+{
+    uint m_windowsCount;
+    uint m_maxWindowSize;
+    uint64_t m_windowSizesSum;
+    uint64_t m_pairTestsCount;
+    uint m_edgesCount;
+    uint m_vertexDegree;
+    size_t m_edgesBytes;
+    size_t m_neighboursBytes;
+
+    RipsStatistics()
+        : m_windowsCount( 0 )
+        , m_maxWindowSize( 0 )
+        , m_windowSizesSum( 0 )
+        , m_pairTestsCount( 0 )
+        , m_edgesCount( 0 )
+        , m_vertexDegree( 0 )
+        , m_edgesBytes( 0 )
+        , m_neighboursBytes( 0 )
+    {}
+
+    double GetMeanWindowSize() const
+    {
+        return m_windowsCount > 0 ? static_cast<double>( m_windowSizesSum ) / m_windowsCount : 0.0;
+    }
+};
+
 // 1-d RipsComplex
 
 class RipsComplex 
@@ -18,23 +53,38 @@ class RipsComplex
 
 public:
 
-    RipsComplex( const PointsList &points, const Metrics &metrics, double epsilon, bool gluePoints );
+    RipsComplex( const PointCloud &points, const Metrics &metrics, double epsilon, bool gluePoints );
+    RipsComplex( const GraphPointCloud &points, const Metrics &metrics, double epsilon, bool gluePoints );
 
-    void Create( const PointsList &points, const Metrics &metrics, double epsilon, bool gluePoints );
+    // Points have to outlive the complex.
+    void Create( const PointCloud &points, const Metrics &metrics, double epsilon, bool gluePoints );
+    // Graph points are read in place with Metrics::GetGraphDistance.
+    void Create( const GraphPointCloud &points, const Metrics &metrics, double epsilon, bool gluePoints );
     void CreateConnectedComponents();
     uint GetConnectedComponentsNumber() const;
+
+    uint GetEdgesCount() const
+    {
+        return m_edges.GetSize();
+    }
+
     void GetProjectionMap( const RipsComplex &rangeComplex, o::Map<uint, uint> &outProjection ) const;
 
+    const RipsStatistics &GetStatistics() const
+    {
+        return m_statistics;
+    }
+
  private:
 
      struct Vertex
      {
-         const Point *m_point;
+         uint m_pointIndex;
          Label m_label;
          uint m_ccIndex;
 
          Vertex()
-             : m_point( nullptr )
+             : m_pointIndex( O_INVALID_INDEX )
              , m_label( O_INVALID_INDEX )
              , m_ccIndex( O_INVALID_INDEX )
          {}
@@ -46,17 +96,50 @@ public:
          double m_distance;
      };
 
-     void CreateVerts( const PointsList &points );
-     o::DynBuffer<VertexRefDist> CalculateVertexReferenceDistance( const Metrics &metrics );
-     void GluePoints( const Metrics &metrics );
+     RipsComplex()
+         : m_points( nullptr )
+         , m_rangePoints( nullptr )
+         , m_vertsCount( 0 )
+         , m_vertexDegree( 0 )
+         , m_vertsFootprint( MemoryFootprint::Category::RipsVerts )
+         , m_edgesFootprint( MemoryFootprint::Category::RipsEdges )
+     {}
+
+     void CreateVerts( const PointCloud &points );
+     void CreateVerts( const GraphPointCloud &points );
+     void CreateVerts( uint count );
      void AssignLabels();
-     void CreateEdges( const Metrics &metrics, double epsilon );
+     // Metrics versions dispatch on the plain points, see DispatchDistance.
+     void CalculateVertexReferenceDistance( const Metrics &metrics, ArenaBuffer<VertexRefDist> &outVertsRefDist );
+     void CreateEdges( const ArenaBuffer<VertexRefDist> &vertsRefDist, const Metrics &metrics, double epsilon );
+
+     // Distance is one of the fixedDistance.h classes picked by DispatchDistance.
+     template <class Distance>
+     void Create( const Distance &distance, double epsilon, bool gluePoints );
+     template <class Distance>
+     void CalculateVertexReferenceDistance( const Distance &distance, ArenaBuffer<VertexRefDist> &outVertsRefDist );
+     template <class Distance>
+     void GluePoints( const Distance &distance );
+     template <class Distance>
+     void CreateEdges( const ArenaBuffer<VertexRefDist> &vertsRefDist, const Distance &distance, double epsilon );
+
+     struct CreateVisitor;
+     struct CalculateVertexReferenceDistanceVisitor;
+     struct CreateEdgesVisitor;
 
-     o::DynBuffer<Vertex> m_verts;
+     const PointCloud *m_points;
+     // Set for graph complexes, vertex coordinates are then split between m_points and m_rangePoints.
+     const PointCloud *m_rangePoints;
+     // Buffers are taken from the current arena, see ArenaScope.
+     ArenaBuffer<Vertex> m_verts;
      uint m_vertsCount;
      SimplexSet m_edges;
      o::DynArray<uint> m_ccRepresentative;
      uint m_vertexDegree;
+     RipsStatistics m_statistics;
+     MemoryFootprintScope m_vertsFootprint;
+     MemoryFootprintScope m_edgesFootprint;
 
+     friend class Benchmarks;
      friend class DataWriter;
 };
@@ -0,0 +1,330 @@
+// pbrendel (c) 2021
+
+#include "simdDistance.h"
+#include "Core/assert.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if SIMD_DISTANCE_KERNELS && ( defined( _M_X64 ) || defined( __x86_64__ ) )
+#define SIMD_DISTANCE_X64 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// Visual C++ accepts the intrinsics of any instruction set without changing the target.
+#define SIMD_TARGET_AVX2
+#define SIMD_TARGET_AVX512
+#else
+// FMA is not enabled for AVX2, so the products and sums are rounded exactly as in the scalar code.
+#define SIMD_TARGET_AVX2 __attribute__(( target( "avx2" ) ))
+#define SIMD_TARGET_AVX512 __attribute__(( target( "avx512f" ) ))
+#endif
+#else
+#define SIMD_DISTANCE_X64 0
+#endif
+
+#if SIMD_DISTANCE_X64 && defined( __GNUC__ ) && !defined( __clang__ )
+// GCC reports the undefined registers the gather and masked AVX-512 intrinsics start from.
+#define SIMD_UNDEFINED_BEGIN _Pragma( "GCC diagnostic push" ) _Pragma( "GCC diagnostic ignored \"-Wmaybe-uninitialized\"" )
+#define SIMD_UNDEFINED_END _Pragma( "GCC diagnostic pop" )
+#else
+#define SIMD_UNDEFINED_BEGIN
+#define SIMD_UNDEFINED_END
+#endif
+
+
+SimdDistance::InstructionSet SimdDistance::s_instructionSet = SimdDistance::GetSupported();
+
+
+static SimdDistance::InstructionSet DetectInstructionSet()
+{
+#if SIMD_DISTANCE_X64
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid( info, 0 );
+    if ( info[0] < 7 )
+    {
+        return SimdDistance::InstructionSet::Scalar;
+    }
+    __cpuid( info, 1 );
+    // The OS has to save the AVX (bits 1, 2) and AVX-512 (bits 5, 6, 7) registers on context switches.
+    if ( ( info[2] & ( 1 << 27 ) ) == 0 )
+    {
+        return SimdDistance::InstructionSet::Scalar;
+    }
+    const unsigned long long xcr0 = _xgetbv( 0 );
+    __cpuidex( info, 7, 0 );
+    if ( ( info[1] & ( 1 << 16 ) ) != 0 && ( xcr0 & 0xe6 ) == 0xe6 )
+    {
+        return SimdDistance::InstructionSet::Avx512;
+    }
+    if ( ( info[1] & ( 1 << 5 ) ) != 0 && ( xcr0 & 0x6 ) == 0x6 )
+    {
+        return SimdDistance::InstructionSet::Avx2;
+    }
+#else
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports( "avx512f" ) )
+    {
+        return SimdDistance::InstructionSet::Avx512;
+    }
+    if ( __builtin_cpu_supports( "avx2" ) )
+    {
+        return SimdDistance::InstructionSet::Avx2;
+    }
+#endif
+#endif
+    return SimdDistance::InstructionSet::Scalar;
+}
+
+
+SimdDistance::InstructionSet SimdDistance::GetSupported()
+{
+    static const InstructionSet s_supported = DetectInstructionSet();
+    return s_supported;
+}
+
+
+void SimdDistance::Set( InstructionSet instructionSet )
+{
+    s_instructionSet = static_cast<uint>( instructionSet ) <= static_cast<uint>( GetSupported() ) ? instructionSet : GetSupported();
+}
+
+
+const char *SimdDistance::GetName( InstructionSet instructionSet )
+{
+    switch ( instructionSet )
+    {
+    case InstructionSet::Avx2: return "avx2";
+    case InstructionSet::Avx512: return "avx512";
+    default: return "scalar";
+    }
+}
+
+
+bool SimdDistance::Parse( const char *name, InstructionSet &outInstructionSet )
+{
+    const InstructionSet instructionSets[] = { InstructionSet::Scalar, InstructionSet::Avx2, InstructionSet::Avx512 };
+    for ( const InstructionSet instructionSet : instructionSets )
+    {
+        if ( strcmp( name, GetName( instructionSet ) ) == 0 )
+        {
+            outInstructionSet = instructionSet;
+            return true;
+        }
+    }
+    return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#if SIMD_DISTANCE_X64
+
+namespace
+{
+
+// Per candidate operations of the metrics, in the order of the scalar GetCoordsDistance.
+template <class M>
+struct ScalarOp
+{
+    static double Get( const double *x, const double *y, uint dim )
+    {
+        return M::GetCoordsDistance( x, y, dim );
+    }
+};
+
+
+struct EuclideanOp : ScalarOp<EuclideanMetrics>
+{
+    SIMD_TARGET_AVX2 static __m256d Accumulate( __m256d d, __m256d x, __m256d y )
+    {
+        const __m256d tmp = _mm256_sub_pd( x, y );
+        return _mm256_add_pd( d, _mm256_mul_pd( tmp, tmp ) );
+    }
+
+    SIMD_TARGET_AVX2 static __m256d Finish( __m256d d )
+    {
+        return _mm256_sqrt_pd( d );
+    }
+
+    // AVX-512 implies FMA in GCC, the explicitly rounded operations are never contracted.
+    SIMD_TARGET_AVX512 static __m512d Accumulate( __m512d d, __m512d x, __m512d y )
+    {
+        const int rounding = _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC;
+        const __m512d tmp = _mm512_sub_pd( x, y );
+        SIMD_UNDEFINED_BEGIN
+        return _mm512_add_round_pd( d, _mm512_mul_round_pd( tmp, tmp, rounding ), rounding );
+        SIMD_UNDEFINED_END
+    }
+
+    SIMD_TARGET_AVX512 static __m512d Finish( __m512d d )
+    {
+        SIMD_UNDEFINED_BEGIN
+        return _mm512_sqrt_pd( d );
+        SIMD_UNDEFINED_END
+    }
+};
+
+
+// max( a, b ) returns b unless a > b, as std::max( d, x - y ) keeps d unless x - y is greater.
+struct MaxOp : ScalarOp<MaxMetrics>
+{
+    SIMD_TARGET_AVX2 static __m256d Accumulate( __m256d d, __m256d x, __m256d y )
+    {
+        return _mm256_max_pd( _mm256_sub_pd( x, y ), d );
+    }
+
+    SIMD_TARGET_AVX2 static __m256d Finish( __m256d d )
+    {
+        return d;
+    }
+
+    SIMD_TARGET_AVX512 static __m512d Accumulate( __m512d d, __m512d x, __m512d y )
+    {
+        SIMD_UNDEFINED_BEGIN
+        return _mm512_max_pd( _mm512_sub_pd( x, y ), d );
+        SIMD_UNDEFINED_END
+    }
+
+    SIMD_TARGET_AVX512 static __m512d Finish( __m512d d )
+    {
+        return d;
+    }
+};
+
+
+struct TaxiOp : ScalarOp<TaxiMetrics>
+{
+    SIMD_TARGET_AVX2 static __m256d Accumulate( __m256d d, __m256d x, __m256d y )
+    {
+        const __m256d signMask = _mm256_set1_pd( -0.0 );
+        return _mm256_add_pd( d, _mm256_andnot_pd( signMask, _mm256_sub_pd( x, y ) ) );
+    }
+
+    SIMD_TARGET_AVX2 static __m256d Finish( __m256d d )
+    {
+        return d;
+    }
+
+    SIMD_TARGET_AVX512 static __m512d Accumulate( __m512d d, __m512d x, __m512d y )
+    {
+        return _mm512_add_pd( d, _mm512_abs_pd( _mm512_sub_pd( x, y ) ) );
+    }
+
+    SIMD_TARGET_AVX512 static __m512d Finish( __m512d d )
+    {
+        return d;
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// DIM is 0 if the dimension is known only at run time. Returns the number of candidates done,
+// the remaining ones do not fill a whole register.
+template <class Op, uint DIM>
+SIMD_TARGET_AVX2 uint GetDistancesAvx2( const double *x, const double *coords, uint dim, const uint *indices, uint count, double *outDistances )
+{
+    const uint n = DIM > 0 ? DIM : dim;
+    const __m128i stride = _mm_set1_epi32( static_cast<int>( n ) );
+    uint k = 0;
+    for ( ; k + 4 <= count; k += 4 )
+    {
+        const __m128i offsets = _mm_mullo_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i *>( indices + k ) ), stride );
+        __m256d d = _mm256_setzero_pd();
+        for ( uint i = 0; i < n; ++i )
+        {
+            SIMD_UNDEFINED_BEGIN
+            const __m256d y = _mm256_i32gather_pd( coords + i, offsets, 8 );
+            SIMD_UNDEFINED_END
+            d = Op::Accumulate( d, _mm256_set1_pd( x[i] ), y );
+        }
+        _mm256_storeu_pd( outDistances + k, Op::Finish( d ) );
+    }
+    return k;
+}
+
+
+template <class Op, uint DIM>
+SIMD_TARGET_AVX512 uint GetDistancesAvx512( const double *x, const double *coords, uint dim, const uint *indices, uint count, double *outDistances )
+{
+    const uint n = DIM > 0 ? DIM : dim;
+    const __m256i stride = _mm256_set1_epi32( static_cast<int>( n ) );
+    uint k = 0;
+    for ( ; k + 8 <= count; k += 8 )
+    {
+        const __m256i offsets = _mm256_mullo_epi32( _mm256_loadu_si256( reinterpret_cast<const __m256i *>( indices + k ) ), stride );
+        __m512d d = _mm512_setzero_pd();
+        for ( uint i = 0; i < n; ++i )
+        {
+            SIMD_UNDEFINED_BEGIN
+            const __m512d y = _mm512_i32gather_pd( offsets, coords + i, 8 );
+            SIMD_UNDEFINED_END
+            d = Op::Accumulate( d, _mm512_set1_pd( x[i] ), y );
+        }
+        _mm512_storeu_pd( outDistances + k, Op::Finish( d ) );
+    }
+    return k;
+}
+
+
+template <class Op, uint DIM>
+uint GetDistancesSimd( SimdDistance::InstructionSet instructionSet, const double *x, const double *coords, uint dim, const uint *indices, uint count, double *outDistances )
+{
+    switch ( instructionSet )
+    {
+    case SimdDistance::InstructionSet::Avx512: return GetDistancesAvx512<Op, DIM>( x, coords, dim, indices, count, outDistances );
+    case SimdDistance::InstructionSet::Avx2: return GetDistancesAvx2<Op, DIM>( x, coords, dim, indices, count, outDistances );
+    default: return 0;
+    }
+}
+
+
+// The fixed dimensions are those of the test configurations, as in FixedDistanceDispatch.
+template <class Op>
+void GetBatchDistances( SimdDistance::InstructionSet instructionSet, const double *x, const double *coords, uint dim, const uint *indices, uint count, double *outDistances )
+{
+    uint done = 0;
+    switch ( dim )
+    {
+    case 1: done = GetDistancesSimd<Op, 1>( instructionSet, x, coords, dim, indices, count, outDistances ); break;
+    case 2: done = GetDistancesSimd<Op, 2>( instructionSet, x, coords, dim, indices, count, outDistances ); break;
+    case 3: done = GetDistancesSimd<Op, 3>( instructionSet, x, coords, dim, indices, count, outDistances ); break;
+    case 4: done = GetDistancesSimd<Op, 4>( instructionSet, x, coords, dim, indices, count, outDistances ); break;
+    default: done = GetDistancesSimd<Op, 0>( instructionSet, x, coords, dim, indices, count, outDistances ); break;
+    }
+    for ( uint k = done; k < count; ++k )
+    {
+        outDistances[k] = Op::Get( x, coords + indices[k] * dim, dim );
+    }
+}
+
+} // namespace
+
+#endif // SIMD_DISTANCE_X64
+
+
+bool SimdDistance::GetDistances( Metrics::Type type, const double *x, const double *coords, uint dim, const uint *indices, uint count, double *outDistances )
+{
+#if SIMD_DISTANCE_X64
+    if ( s_instructionSet == InstructionSet::Scalar )
+    {
+        return false;
+    }
+#ifndef NDEBUG
+    // Gathers address the coordinates with 32 bit signed offsets.
+    for ( uint k = 0; k < count; ++k )
+    {
+        assert( static_cast<uint64_t>( indices[k] ) * dim <= INT32_MAX );
+    }
+#endif
+    switch ( type )
+    {
+    case Metrics::Type::Euclidean: GetBatchDistances<EuclideanOp>( s_instructionSet, x, coords, dim, indices, count, outDistances ); return true;
+    case Metrics::Type::Max: GetBatchDistances<MaxOp>( s_instructionSet, x, coords, dim, indices, count, outDistances ); return true;
+    case Metrics::Type::Taxi: GetBatchDistances<TaxiOp>( s_instructionSet, x, coords, dim, indices, count, outDistances ); return true;
+    default: return false;
+    }
+#else
+    return false;
+#endif
+}
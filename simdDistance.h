@@ -0,0 +1,49 @@
+// pbrendel (c) 2021
+
+#pragma once
+
+#include "metrics.h"
+
+// Set to 0 to evaluate the batches of distances one candidate at a time.
+#ifndef SIMD_DISTANCE_KERNELS
+#define SIMD_DISTANCE_KERNELS 1
+#endif
+
+
+// Batches of Euclidean, max and taxi distances computed for 4 (AVX2) or 8 (AVX-512) candidates
+// at once. The coordinates of the candidates are gathered from the double precision storage of
+// a cloud and the per candidate operations are the same as in the scalar code, so the results
+// are exactly the same.
+class SimdDistance
+{
+public:
+
+    enum class InstructionSet : uint
+    {
+        Scalar,
+        Avx2,
+        Avx512,
+    };
+
+    // Best instruction set of the CPU, detected once.
+    static InstructionSet GetSupported();
+
+    static InstructionSet Get()
+    {
+        return s_instructionSet;
+    }
+
+    // The instruction set is limited to the supported one.
+    static void Set( InstructionSet instructionSet );
+
+    static const char *GetName( InstructionSet instructionSet );
+    static bool Parse( const char *name, InstructionSet &outInstructionSet );
+
+    // outDistances[k] is the distance from x to the point indices[k] of the cloud coordinates, dim per
+    // point. Returns false, without writing anything, if there is no kernel for the metrics type.
+    static bool GetDistances( Metrics::Type type, const double *x, const double *coords, uint dim, const uint *indices, uint count, double *outDistances );
+
+private:
+
+    static InstructionSet s_instructionSet;
+};
@@ -134,10 +134,8 @@ void SimplexSet::Resize()
 	const uint newCapacity = capacity == 0 ? 2 : capacity * 2;
 	const uint newLabelsSize = GetSimplexOffset( newCapacity );
 	const uint oldLabelsSize = GetSimplexOffset( capacity );
-	Label *newLabels = new Label[newLabelsSize];
-	memcpy( newLabels, m_labels.Get(), oldLabelsSize * sizeof( Label ) );
-	std::fill_n( newLabels + oldLabelsSize, newLabelsSize - oldLabelsSize, INVALID_LABEL );
-	m_labels.Reset( newLabels, newLabelsSize );
+	m_labels.Resize( newLabelsSize );
+	std::fill_n( m_labels.Get() + oldLabelsSize, newLabelsSize - oldLabelsSize, INVALID_LABEL );
 }
 
 
@@ -2,7 +2,7 @@
 
 #pragma once
 
-#include "Core/dynBuffer.h"
+#include "arena.h"
 #include "Core/types.h"
 
 class SimplexSet;
@@ -71,6 +71,11 @@ public:
 		return m_labels.GetSize() / ( m_dim + 1 );
 	}
 
+	size_t GetMemoryFootprint() const
+	{
+		return m_labels.GetSize() * sizeof( Label );
+	}
+
 	Simplex PushBack();
 	void PopBack();
 	void Remove( uint index );
@@ -85,7 +90,8 @@ private:
 	uint GetSimplexOffset( uint index ) const;
 	void Resize();
 
-	o::DynBuffer<Label> m_labels;
+	// Taken from the current arena, see ArenaScope.
+	ArenaBuffer<Label> m_labels;
 	uint m_dim;
 	uint m_size;
 	bool m_dirty;
@@ -0,0 +1,58 @@
+// pbrendel (c) 2021
+
+#include "spaceFillingCurve.h"
+#include "cube.h"
+#include "pointCloud.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+using o::DynArray;
+
+
+// Coordinates are quantized to as many bits as fit into the 64 bit code.
+static uint64_t GetMortonCode( ConstPointView p, const Cube &cube, uint bits )
+{
+    const uint dim = p.GetDimension();
+    const double maxCell = static_cast<double>( ( uint64_t( 1 ) << bits ) - 1 );
+    uint64_t cells[8] = { 0 };
+    for ( uint d = 0; d < dim; ++d )
+    {
+        const double length = cube[d].GetLength();
+        const double t = length > 0.0 ? ( p[d] - cube[d].m_min ) / length : 0.0;
+        cells[d] = static_cast<uint64_t>( std::min( std::max( t, 0.0 ), 1.0 ) * maxCell );
+    }
+    uint64_t code = 0;
+    for ( uint b = bits; b-- > 0; )
+    {
+        for ( uint d = 0; d < dim; ++d )
+        {
+            code = ( code << 1 ) | ( ( cells[d] >> b ) & 1 );
+        }
+    }
+    return code;
+}
+
+
+void CreateMortonOrder( const PointCloud &points, const Cube &cube, DynArray<uint> &outPermutation )
+{
+    ProfileScope scope( "CreateMortonOrder" );
+    const uint dim = points.GetDimension();
+    const uint count = points.GetSize();
+    assert( cube.GetDimension() == dim );
+    assertex( dim > 0 && dim <= 8, "Morton order supports dimensions up to 8" );
+    const uint bits = std::min( 32u, 64u / dim );
+    DynArray<std::pair<uint64_t, uint>> codes( count );
+    for ( uint i = 0; i < count; ++i )
+    {
+        codes[i] = std::make_pair( GetMortonCode( points[i], cube, bits ), i );
+    }
+    std::sort( codes.Begin(), codes.End() );
+    outPermutation.Resize( count );
+    for ( uint i = 0; i < count; ++i )
+    {
+        outPermutation[i] = codes[i].second;
+    }
+}
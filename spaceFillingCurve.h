@@ -0,0 +1,13 @@
+// pbrendel (c) 2021
+
+#pragma once
+
+#include "Core/dynArray.h"
+
+class Cube;
+class PointCloud;
+
+
+// Order of the points along the Morton (Z-order) curve over the cube. Element i of the permutation
+// is the index of the i-th point on the curve, points with the same code keep their order.
+void CreateMortonOrder( const PointCloud &points, const Cube &cube, o::DynArray<uint> &outPermutation );
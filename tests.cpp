@@ -5,15 +5,22 @@
 #include "domain.h"
 #include "exitSetQuotientMetrics.h"
 #include "horseshoeMap.h"
+#include "instrumentedMetrics.h"
 #include "localKernelsPersistence.h"
 #include "map.h"
+#include "memoryFootprint.h"
 #include "noise.h"
+#include "hardwareCounters.h"
+#include "profiler.h"
+#include "progress.h"
 #include "qualityFunction.h"
+#include "trace.h"
 
 #include <ctime>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <utility>
 
 using o::DynArray;
 using o::Ptr;
@@ -26,6 +33,7 @@ TestParams::TestParams( const std::string &params )
     m_domainSize = 11;
     m_domainCube.SetDimension( 1 );
     m_domainCube[0] = Interval( 0, 1 );
+    m_domainOrder = DomainOrder::Generated;
     m_mapType = MapType::LinearDiscontinous;
     m_mapParams.PushBack( 1.0 );
     m_noiseDelta = 0;
@@ -39,6 +47,13 @@ TestParams::TestParams( const std::string &params )
     m_restrictionRadius = 0.2;
     m_qualityFunctionNumber = 1;
     m_outputFilename = "output.txt";
+    m_showGraph = false;
+    m_progressInterval = 0;
+    m_hardwareCounters = false;
+    m_writeCost = false;
+    m_precision = PointCloud::Precision::Double;
+    m_comparePrecision = false;
+    m_instructionSet = SimdDistance::GetSupported();
 
     const char *separator = "--";
     const size_t separatorSize = strlen( separator );
@@ -66,7 +81,9 @@ void TestParams::Print( std::ostream &str ) const
     }
     std::cout << std::endl;
     str << "noise " << m_noiseDelta << std::endl;
+    str << "domain order " << static_cast<uint>( m_domainOrder ) << std::endl;
     str << "metrics " << static_cast<uint>( m_metricsType ) << std::endl;
+    str << "simd " << SimdDistance::GetName( m_instructionSet ) << std::endl;
     str << "epsilons " << m_epsilonsInterval.m_min << " " << m_epsilonsInterval.m_max << " " << m_epsilonsCount << std::endl;
     str << "alpha " << m_alpha << std::endl;
     str << "beta " << m_beta << std::endl;
@@ -74,10 +91,25 @@ void TestParams::Print( std::ostream &str ) const
     str << "radius " << m_restrictionRadius << std::endl;
     str << "quality function: " << m_qualityFunctionNumber << std::endl;
     str << "output filename: " << m_outputFilename << std::endl;
+    if ( !m_traceFilename.empty() )
+    {
+        str << "trace filename: " << m_traceFilename << std::endl;
+    }
 }
 
 
 Ptr<Domain> TestParams::CreateDomain() const
+{
+    Domain *domain = CreateGeneratedDomain();
+    if ( m_domainOrder == DomainOrder::Morton )
+    {
+        return new ReorderedDomain( domain );
+    }
+    return domain;
+}
+
+
+Domain *TestParams::CreateGeneratedDomain() const
 {
     Cube cube;
     CreateDomainCube( cube );
@@ -343,6 +375,49 @@ void TestParams::ParseParams( const std::string &params )
     {
         ParseString( stream, m_outputFilename );
     }
+    else if ( str == "--trace" )
+    {
+        ParseString( stream, m_traceFilename );
+    }
+    else if ( str == "--progress" )
+    {
+        ParseDouble( stream, m_progressInterval );
+        ParseString( stream, m_progressFilename );
+    }
+    else if ( str == "--counters" )
+    {
+        ParseBool( stream, m_hardwareCounters );
+    }
+    else if ( str == "--cost" )
+    {
+        ParseBool( stream, m_writeCost );
+    }
+    else if ( str == "--single" )
+    {
+        bool single = false;
+        ParseBool( stream, single );
+        m_precision = single ? PointCloud::Precision::Single : PointCloud::Precision::Double;
+    }
+    else if ( str == "--precision" )
+    {
+        ParsePrecision( stream );
+    }
+    else if ( str == "--compare-precision" )
+    {
+        ParseBool( stream, m_comparePrecision );
+    }
+    else if ( str == "--reorder" )
+    {
+        ParseDomainOrder( stream );
+    }
+    else if ( str == "--simd" )
+    {
+        std::string name;
+        if ( stream >> name && !SimdDistance::Parse( name.c_str(), m_instructionSet ) )
+        {
+            std::cout << "error parsing params: unknown instruction set: " << name << std::endl;
+        }
+    }
     else if ( str == "--graph" )
     {
         ParseBool( stream, m_showGraph );
@@ -400,6 +475,7 @@ void TestParams::ParseMap( std::istream &stream )
     std::string str;
     if ( stream >> str )
     {
+        m_mapParams.Clear();
         if ( str == "linear1d" )
         {
             m_mapParams.PushBack( 1.0 );
@@ -481,6 +557,56 @@ void TestParams::ParseMetrics( std::istream &stream )
 }
 
 
+void TestParams::ParseDomainOrder( std::istream &stream )
+{
+    std::string str;
+    if ( stream >> str )
+    {
+        if ( str == "none" )
+        {
+            m_domainOrder = DomainOrder::Generated;
+        }
+        else if ( str == "morton" )
+        {
+            m_domainOrder = DomainOrder::Morton;
+        }
+        else
+        {
+            std::cout << "error parsing params: unknown domain order: " << str << std::endl;
+        }
+    }
+}
+
+
+void TestParams::ParsePrecision( std::istream &stream )
+{
+    std::string str;
+    if ( stream >> str )
+    {
+        if ( str == "double" )
+        {
+            m_precision = PointCloud::Precision::Double;
+        }
+        else if ( str == "single" )
+        {
+            m_precision = PointCloud::Precision::Single;
+        }
+        else if ( str == "fixed16" )
+        {
+            m_precision = PointCloud::Precision::Fixed16;
+        }
+        else if ( str == "fixed32" )
+        {
+            m_precision = PointCloud::Precision::Fixed32;
+        }
+        else
+        {
+            std::cout << "error parsing params: unknown precision: " << str << std::endl;
+        }
+    }
+}
+
+
 void TestParams::ParseTest( std::istream &stream )
 {
     std::string str;
@@ -554,43 +680,218 @@ void Tests::RunSingle( const std::string &paramsString )
     TestParams testParams( paramsString );
     testParams.Print( std::cout );
 
+    Profiler::Get().Reset();
+    MetricsStatistics::Get().Reset();
+    MemoryFootprint::Get().Reset();
+    if ( !testParams.GetTraceFilename().empty() && !Trace::Get().Open( testParams.GetTraceFilename() ) )
+    {
+        std::cout << "cannot open trace file " << testParams.GetTraceFilename() << std::endl;
+    }
+    HardwareCounters::Get().Reset();
+    if ( testParams.GetHardwareCounters() && !HardwareCounters::Get().Enable() )
+    {
+        std::cout << "hardware counters are not available" << std::endl;
+    }
+    if ( testParams.GetProgressInterval() > 0 )
+    {
+        Progress::Get().Enable( testParams.GetProgressInterval(), testParams.GetProgressFilename() );
+    }
+    SimdDistance::Set( testParams.GetInstructionSet() );
+    if ( SimdDistance::Get() != testParams.GetInstructionSet() )
+    {
+        std::cout << "instruction set " << SimdDistance::GetName( testParams.GetInstructionSet() ) << " is not supported, using "
+                  << SimdDistance::GetName( SimdDistance::Get() ) << std::endl;
+    }
+    Compute( testParams );
+    Progress::Get().Disable();
+    Trace::Get().Close();
+    Profiler::Get().Print( std::cout );
+    MetricsStatistics::Get().Print( std::cout );
+    HardwareCounters::Get().Print( std::cout );
+    MemoryFootprint::Get().Print( std::cout );
+    HardwareCounters::Get().Disable();
+
+    if ( testParams.GetShowGraph() )
+    {
+        ShowGraph( testParams.GetOutputFilename() );
+    }
+}
+
+
+void Tests::Compute( const TestParams &testParams )
+{
+    ProfileScope scope( "Tests::Compute" );
+
+    // The domain is created before the metrics tell whether a reduced precision is supported,
+    // so its storage stays double and only the per run clouds use the requested precision.
+    PointCloud::SetDefaultPrecision( PointCloud::Precision::Double );
     Ptr<Domain> domain = testParams.CreateDomain();
     Ptr<Noise> noise = testParams.CreateNoise();
     Ptr<Map> map = testParams.CreateMap( *domain, noise.Get() );
     Ptr<Metrics> domainMetrics = testParams.CreateMetrics( *domain, *map );
+    const bool precisionSupported = !domainMetrics->RequiresDoublePrecision();
+    if ( !precisionSupported && ( testParams.GetPrecision() != PointCloud::Precision::Double || testParams.GetComparePrecision() ) )
+    {
+        std::cout << "reduced precision is not supported by the metrics, using double precision" << std::endl;
+    }
+    const PointCloud::Precision precision = precisionSupported ? testParams.GetPrecision() : PointCloud::Precision::Double;
+    PointCloud::SetDefaultPrecision( precision );
     Ptr<Metrics> graphMetrics = new MaxDomainRangeMetrics( *domainMetrics, *domainMetrics, domain->GetDimension(), map->GetDimension() );
     Ptr<Domain> testDomain = testParams.CreateTestDomain();
     DynArray<double> epsilons;
     testParams.CreateEpsilons( epsilons );
 
     PersistenceData persistenceData;
+    ComputePersistence( testParams, *domain, *map, *testDomain, epsilons, *domainMetrics, *graphMetrics, persistenceData );
+    if ( testParams.GetComparePrecision() && precisionSupported )
+    {
+        // The double precision results are the reference, whichever precision was requested.
+        const bool reference = precision == PointCloud::Precision::Double;
+        const PointCloud::Precision otherPrecision = reference ? PointCloud::Precision::Single : PointCloud::Precision::Double;
+        PointCloud::SetDefaultPrecision( otherPrecision );
+        PersistenceData otherPersistenceData;
+        ComputePersistence( testParams, *domain, *map, *testDomain, epsilons, *domainMetrics, *graphMetrics, otherPersistenceData );
+        PointCloud::SetDefaultPrecision( precision );
+        ComparePersistence( reference ? persistenceData : otherPersistenceData, reference ? otherPersistenceData : persistenceData, reference ? otherPrecision : precision, std::cout );
+    }
+    MemoryFootprint::Get().SetPointsCount( domain->GetCount() );
+    const MemoryFootprintScope persistenceDataFootprint( MemoryFootprint::Category::PersistenceData, GetMemoryFootprint( persistenceData ) );
+
+    std::ofstream output( testParams.GetOutputFilename().c_str() );
+    Ptr<QualityFunction> qualityFunction = testParams.CreateQualityFunction();
+    {
+        ProfileScope scope( "QualityFunction::Init" );
+        qualityFunction->Init( persistenceData, epsilons.GetSize() );
+    }
+    for ( PersistenceData::Iterator i = persistenceData.Begin(); i != persistenceData.End(); ++i )
+    {
+        i->ApplyMap( *map );
+        i->CalculateQuality( *qualityFunction );
+        ProfileScope scope( "Output" );
+        if ( testParams.GetWriteCost() )
+        {
+            output << PersistenceCostWriter( *i );
+        }
+        else
+        {
+            output << *i;
+        }
+    }
+
+    output.close();
+}
+
+
+void Tests::ComputePersistence( const TestParams &testParams, const Domain &domain, const Map &map, const Domain &testDomain, const DynArray<double> &epsilons,
+                                const Metrics &domainMetrics, const Metrics &graphMetrics, PersistenceData &outPersistenceData )
+{
     const uint algorithmId = testParams.GetAlgorithmId();
     assertex( algorithmId == 1 || algorithmId == 2, "Not supported algorithm Id" );
+    LocalKernelsPersistence::Statistics statistics;
     if ( algorithmId == 1 )
     {
-        LocalKernelsPersistence::Compute_Alg1( *domain, *map, *testDomain, epsilons, testParams.GetRestrictionRadius(), *domainMetrics, *graphMetrics, persistenceData );
+        LocalKernelsPersistence::Compute_Alg1( domain, map, testDomain, epsilons, testParams.GetRestrictionRadius(), domainMetrics, graphMetrics, outPersistenceData, &statistics );
     }
     else
     {
-        LocalKernelsPersistence::Compute_Alg2( *domain, *map, testParams.GetAlpha(), testParams.GetBeta(), *domainMetrics, persistenceData );
+        LocalKernelsPersistence::Compute_Alg2( domain, map, testParams.GetAlpha(), testParams.GetBeta(), domainMetrics, outPersistenceData, &statistics );
+        // Alg1 reports the test domain points, which are not reordered.
+        if ( testParams.GetReorderDomain() )
+        {
+            RestoreDomainOrder( static_cast<const ReorderedDomain &>( domain ).GetPermutation(), outPersistenceData );
+        }
+    }
+    if ( statistics.m_euclideanErrorBound > 0.0 || statistics.m_clampedCoordsCount > 0 )
+    {
+        std::cout << "quantization error bounds: coordinates " << statistics.m_coordinateErrorBound << ", euclidean distances " << statistics.m_euclideanErrorBound
+                  << ", clamped coordinates " << statistics.m_clampedCoordsCount << std::endl;
     }
+}
 
-    std::ofstream output( testParams.GetOutputFilename().c_str() );
-    Ptr<QualityFunction> qualityFunction = testParams.CreateQualityFunction();
-    qualityFunction->Init( persistenceData, epsilons.GetSize() );
-    for ( PersistenceData::Iterator i = persistenceData.Begin(); i != persistenceData.End(); ++i )
+
+// Names of the precisions as given in the params.
+static const char *GetPrecisionName( PointCloud::Precision precision )
+{
+    switch ( precision )
     {
-        i->ApplyMap( *map );
-        i->CalculateQuality( *qualityFunction );        
-        output << *i;
+    case PointCloud::Precision::Double: return "double";
+    case PointCloud::Precision::Single: return "single";
+    case PointCloud::Precision::Fixed16: return "fixed16";
+    case PointCloud::Precision::Fixed32: return "fixed32";
     }
+    return "";
+}
 
-    output.close();
 
-    if ( testParams.GetShowGraph() )
+// Alg2 reports one center per domain point, in the order of the domain points.
+void Tests::RestoreDomainOrder( const DynArray<uint> &permutation, PersistenceData &persistenceData )
+{
+    ProfileScope scope( "Tests::RestoreDomainOrder" );
+    const uint count = permutation.GetSize();
+    if ( persistenceData.GetSize() != count )
     {
-        ShowGraph( testParams.GetOutputFilename() );
+        std::cout << "some centers were skipped, results are reported in the reordered domain order" << std::endl;
+        return;
+    }
+    DynArray<uint> inversePermutation( count );
+    for ( uint i = 0; i < count; ++i )
+    {
+        inversePermutation[permutation[i]] = i;
+    }
+    PersistenceData reordered;
+    for ( uint i = 0; i < count; ++i )
+    {
+        reordered.PushBack( std::move( persistenceData[inversePermutation[i]] ) );
+    }
+    persistenceData.Clear();
+    for ( uint i = 0; i < count; ++i )
+    {
+        persistenceData.PushBack( std::move( reordered[i] ) );
+    }
+}
+
+
+// Connected components of the graph complexes show up as the homology classes of the diagrams, so comparing
+// the diagrams checks the components counts for all the epsilons. Maps with noise give different results anyway.
+void Tests::ComparePersistence( const PersistenceData &reference, const PersistenceData &persistenceData, PointCloud::Precision precision, std::ostream &str )
+{
+    const uint centersCount = std::min( reference.GetSize(), persistenceData.GetSize() );
+    uint componentsMismatches = 0;
+    uint diagramMismatches = 0;
+    uint edgesMismatches = 0;
+    for ( uint i = 0; i < centersCount; ++i )
+    {
+        const PersistenceDiagram &referenceDiagram = reference[i].GetPersistenceDiagram();
+        const PersistenceDiagram &diagram = persistenceData[i].GetPersistenceDiagram();
+        const size_t referenceClasses = referenceDiagram.End() - referenceDiagram.Begin();
+        const size_t classes = diagram.End() - diagram.Begin();
+        if ( referenceClasses != classes )
+        {
+            componentsMismatches++;
+            diagramMismatches++;
+        }
+        else
+        {
+            for ( PersistenceDiagram::Iterator a = referenceDiagram.Begin(), b = diagram.Begin(); a != referenceDiagram.End(); ++a, ++b )
+            {
+                if ( a->m_column != b->m_column || a->m_birth != b->m_birth || a->m_death != b->m_death )
+                {
+                    diagramMismatches++;
+                    break;
+                }
+            }
+        }
+        const PointPersistenceData::Cost &referenceCost = reference[i].GetCost();
+        const PointPersistenceData::Cost &cost = persistenceData[i].GetCost();
+        if ( referenceCost.m_domainEdgesCount != cost.m_domainEdgesCount || referenceCost.m_graphEdgesCount != cost.m_graphEdgesCount )
+        {
+            edgesMismatches++;
+        }
     }
+    str << "precision comparison: " << reference.GetSize() << " / " << persistenceData.GetSize() << " centers (double / " << GetPrecisionName( precision ) << ")" << std::endl;
+    str << "  components count mismatches: " << componentsMismatches << std::endl;
+    str << "  diagram mismatches:          " << diagramMismatches << std::endl;
+    str << "  edges count mismatches:      " << edgesMismatches << std::endl;
 }
 
 
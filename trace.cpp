@@ -0,0 +1,81 @@
+// pbrendel (c) 2021
+
+#include "trace.h"
+
+#include <iomanip>
+
+
+Trace &Trace::Get()
+{
+    static Trace trace;
+    return trace;
+}
+
+
+Trace::Trace()
+    : m_enabled( false )
+    , m_firstEvent( true )
+{
+}
+
+
+Trace::~Trace()
+{
+    Close();
+}
+
+
+bool Trace::Open( const std::string &filename )
+{
+    Close();
+    m_stream.open( filename.c_str() );
+    if ( !m_stream.is_open() )
+    {
+        return false;
+    }
+    m_stream << std::setprecision( 10 ) << "{\"traceEvents\":[";
+    m_start = std::chrono::steady_clock::now();
+    m_enabled = true;
+    m_firstEvent = true;
+    return true;
+}
+
+
+void Trace::Close()
+{
+    if ( !m_enabled )
+    {
+        return;
+    }
+    m_stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    m_stream.close();
+    m_enabled = false;
+}
+
+
+double Trace::GetTimestamp() const
+{
+    return std::chrono::duration<double, std::micro>( std::chrono::steady_clock::now() - m_start ).count();
+}
+
+
+void Trace::WriteSpan( const char *name, double begin, double end, const char * const *argNames, const double *argValues, uint argsCount )
+{
+    if ( !m_enabled )
+    {
+        return;
+    }
+    m_stream << ( m_firstEvent ? "\n" : ",\n" );
+    m_firstEvent = false;
+    m_stream << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << begin << ",\"dur\":" << ( end - begin );
+    if ( argsCount > 0 )
+    {
+        m_stream << ",\"args\":{";
+        for ( uint i = 0; i < argsCount; ++i )
+        {
+            m_stream << ( i > 0 ? "," : "" ) << "\"" << argNames[i] << "\":" << argValues[i];
+        }
+        m_stream << "}";
+    }
+    m_stream << "}";
+}
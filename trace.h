@@ -0,0 +1,96 @@
+// pbrendel (c) 2021
+
+#pragma once
+
+#include "Core/assert.h"
+#include "Core/types.h"
+
+#include <chrono>
+#include <fstream>
+#include <string>
+
+
+// Writes spans in the Chrome trace-event JSON format, viewable in chrome://tracing or Perfetto.
+// All spans are complete ("X") events on a single thread, written when they end.
+class Trace
+{
+public:
+
+    static Trace &Get();
+
+    bool Open( const std::string &filename );
+    void Close();
+
+    bool IsEnabled() const
+    {
+        return m_enabled;
+    }
+
+    // Microseconds since the trace was opened.
+    double GetTimestamp() const;
+
+    void WriteSpan( const char *name, double begin, double end, const char * const *argNames, const double *argValues, uint argsCount );
+
+private:
+
+    Trace();
+    ~Trace();
+
+    std::ofstream m_stream;
+    std::chrono::steady_clock::time_point m_start;
+    bool m_enabled;
+    bool m_firstEvent;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+class TraceScope
+{
+public:
+
+    enum : uint
+    {
+        MAX_ARGS = 8,
+    };
+
+    // Name and argument names have to outlive the scope, string literals are expected here.
+    TraceScope( const char *name )
+        : m_name( name )
+        , m_argsCount( 0 )
+        , m_enabled( Trace::Get().IsEnabled() )
+    {
+        if ( m_enabled )
+        {
+            m_begin = Trace::Get().GetTimestamp();
+        }
+    }
+
+    ~TraceScope()
+    {
+        if ( m_enabled )
+        {
+            Trace::Get().WriteSpan( m_name, m_begin, Trace::Get().GetTimestamp(), m_argNames, m_argValues, m_argsCount );
+        }
+    }
+
+    // Arguments are counted also when tracing is disabled, so going over the limit asserts in every run.
+    void AddArg( const char *name, double value )
+    {
+        assertex( m_argsCount < MAX_ARGS, "Too many trace arguments" );
+        if ( m_argsCount < MAX_ARGS )
+        {
+            m_argNames[m_argsCount] = name;
+            m_argValues[m_argsCount] = value;
+            m_argsCount++;
+        }
+    }
+
+private:
+
+    const char *m_name;
+    const char *m_argNames[MAX_ARGS];
+    double m_argValues[MAX_ARGS];
+    uint m_argsCount;
+    double m_begin;
+    bool m_enabled;
+};